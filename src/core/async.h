@@ -0,0 +1,97 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGCORE_ASYNC_H
+#define NGCORE_ASYNC_H
+
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QObject>
+
+/**
+ * @brief Call function in the context object thread when future finishes.
+ * Function is not called if context is destroyed before. Must be called from
+ * the context object thread.
+ * @param future Future to wait for.
+ * @param context Object which event loop runs function.
+ * @param function Callable taking finished QFuture<T>.
+ */
+template<typename T, typename Function>
+void ngThen(const QFuture<T> &future, QObject *context, Function function)
+{
+    QFutureWatcher<T> *watcher = new QFutureWatcher<T>(context);
+    QObject::connect(watcher, &QFutureWatcherBase::finished, context,
+                     [watcher, function]() mutable {
+        function(watcher->future());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(future);
+}
+
+// C++20 coroutine support: co_await QFuture in a coroutine returning NGTask.
+// Coroutine resumes in the awaiting thread, which must run Qt event loop.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#include <exception>
+
+/**
+ * @brief The NGTask class is return type of fire-and-forget coroutines.
+ */
+struct NGTask
+{
+    struct promise_type {
+        NGTask get_return_object() { return NGTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+template<typename T>
+struct NGFutureAwaiter
+{
+    QFuture<T> future;
+
+    bool await_ready() const { return future.isFinished(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+        QFutureWatcher<T> *watcher = new QFutureWatcher<T>;
+        QObject::connect(watcher, &QFutureWatcherBase::finished,
+                         [watcher, handle]() {
+            watcher->deleteLater();
+            handle.resume();
+        });
+        watcher->setFuture(future);
+    }
+    T await_resume() { return future.result(); }
+};
+
+template<>
+inline void NGFutureAwaiter<void>::await_resume() {}
+
+template<typename T>
+NGFutureAwaiter<T> operator co_await(const QFuture<T> &future)
+{
+    return NGFutureAwaiter<T>{future};
+}
+#endif // __has_include(<coroutine>)
+#endif // __cpp_impl_coroutine
+
+#endif // NGCORE_ASYNC_H
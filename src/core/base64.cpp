@@ -0,0 +1,325 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/base64.h"
+
+// SSSE3 kernels are selected at runtime on GCC/Clang x86 builds. Other
+// compilers and architectures use scalar code only.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#   include <tmmintrin.h>
+#   define NGSTD_BASE64_SSSE3
+#   define SSSE3_TARGET __attribute__((target("ssse3")))
+#endif
+
+static const char *stdAlphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char *urlAlphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+constexpr unsigned char invalidChar = 0xFF;
+
+struct DecodeTable {
+    unsigned char values[256];
+    DecodeTable() {
+        for(int i = 0; i < 256; ++i) {
+            values[i] = invalidChar;
+        }
+        for(unsigned char i = 0; i < 64; ++i) {
+            values[static_cast<unsigned char>(stdAlphabet[i])] = i;
+            values[static_cast<unsigned char>(urlAlphabet[i])] = i;
+        }
+    }
+};
+
+static const DecodeTable decodeTable;
+
+#ifdef NGSTD_BASE64_SSSE3
+
+static bool hasSSSE3()
+{
+    static const bool result = __builtin_cpu_supports("ssse3");
+    return result;
+}
+
+// Encode 12 bytes (of 16 loaded) into 16 characters.
+// See http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html
+SSSE3_TARGET
+static size_t encodeSSSE3(const unsigned char *&in, size_t size, char *out, bool url)
+{
+    const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+                                         4, 5, 3, 4, 1, 2, 0, 1);
+    // Offsets from 6 bit value to character. Index 12 is 62 ('+' or '-'),
+    // 13 is 63 ('/' or '_').
+    const __m128i lut = url ?
+                _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -17, 32, 0, 0) :
+                _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    const __m128i maskAC = _mm_set1_epi32(0x0fc0fc00);
+    const __m128i mulAC = _mm_set1_epi32(0x04000040);
+    const __m128i maskBD = _mm_set1_epi32(0x003f03f0);
+    const __m128i mulBD = _mm_set1_epi32(0x01000010);
+    const __m128i const51 = _mm_set1_epi8(51);
+    const __m128i const25 = _mm_set1_epi8(25);
+
+    char *start = out;
+    while(size >= 16) {
+        __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        data = _mm_shuffle_epi8(data, shuffle);
+        __m128i ac = _mm_mulhi_epu16(_mm_and_si128(data, maskAC), mulAC);
+        __m128i bd = _mm_mullo_epi16(_mm_and_si128(data, maskBD), mulBD);
+        __m128i indices = _mm_or_si128(ac, bd);
+
+        __m128i offsets = _mm_subs_epu8(indices, const51);
+        offsets = _mm_sub_epi8(offsets, _mm_cmpgt_epi8(indices, const25));
+        __m128i chars = _mm_add_epi8(indices, _mm_shuffle_epi8(lut, offsets));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), chars);
+
+        in += 12;
+        size -= 12;
+        out += 16;
+    }
+    return static_cast<size_t>(out - start);
+}
+
+// Decode 16 characters into 12 bytes. Stops on first block with characters
+// outside of alphabet, the rest is processed by scalar code.
+// See http://0x80.pl/notesen/2016-01-17-sse-base64-decoding.html
+SSSE3_TARGET
+static size_t decodeSSSE3(const char *&in, size_t size, unsigned char *out)
+{
+    const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                          0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask2F = _mm_set1_epi8(0x2F);
+    const __m128i minus = _mm_set1_epi8('-');
+    const __m128i underscore = _mm_set1_epi8('_');
+    const __m128i minusToPlus = _mm_set1_epi8('+' - '-');
+    const __m128i underscoreToSlash = _mm_set1_epi8('/' - '_');
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mergeAB = _mm_set1_epi32(0x01400140);
+    const __m128i mergeABC = _mm_set1_epi32(0x00011000);
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                       -1, -1, -1, -1);
+
+    unsigned char *start = out;
+    // 16 bytes are stored for 12 decoded, keep enough input to not overrun
+    // the output buffer.
+    while(size >= 24) {
+        __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+
+        // Map base64url to standard alphabet
+        str = _mm_add_epi8(str, _mm_and_si128(_mm_cmpeq_epi8(str, minus), minusToPlus));
+        str = _mm_add_epi8(str, _mm_and_si128(_mm_cmpeq_epi8(str, underscore), underscoreToSlash));
+
+        __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask2F);
+        __m128i loNibbles = _mm_and_si128(str, mask2F);
+        __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+        __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), zero)) != 0xFFFF) {
+            break;
+        }
+
+        __m128i eq2F = _mm_cmpeq_epi8(str, mask2F);
+        __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2F, hiNibbles));
+        str = _mm_add_epi8(str, roll);
+
+        str = _mm_maddubs_epi16(str, mergeAB);
+        str = _mm_madd_epi16(str, mergeABC);
+        str = _mm_shuffle_epi8(str, pack);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), str);
+
+        in += 16;
+        size -= 16;
+        out += 12;
+    }
+    return static_cast<size_t>(out - start);
+}
+
+#endif // NGSTD_BASE64_SSSE3
+
+size_t base64EncodedSize(size_t size, bool url)
+{
+    if(url) {
+        return size / 3 * 4 + (size % 3 == 0 ? 0 : size % 3 + 1);
+    }
+    return (size + 2) / 3 * 4;
+}
+
+/**
+ * @brief Encode buffer to base64.
+ * @param data Input bytes.
+ * @param size Input size.
+ * @param out Output buffer, at least base64EncodedSize() bytes.
+ * @param url Use base64url alphabet and omit padding.
+ * @return Number of characters written.
+ */
+size_t base64Encode(const unsigned char *data, size_t size, char *out, bool url)
+{
+    const char *alphabet = url ? urlAlphabet : stdAlphabet;
+    const unsigned char *in = data;
+    const unsigned char *end = data + size;
+    char *cur = out;
+
+#ifdef NGSTD_BASE64_SSSE3
+    if(hasSSSE3()) {
+        cur += encodeSSSE3(in, size, cur, url);
+    }
+#endif // NGSTD_BASE64_SSSE3
+
+    while(end - in >= 3) {
+        unsigned int value = (static_cast<unsigned int>(in[0]) << 16) |
+                (static_cast<unsigned int>(in[1]) << 8) | in[2];
+        *cur++ = alphabet[(value >> 18) & 0x3F];
+        *cur++ = alphabet[(value >> 12) & 0x3F];
+        *cur++ = alphabet[(value >> 6) & 0x3F];
+        *cur++ = alphabet[value & 0x3F];
+        in += 3;
+    }
+
+    size_t rest = static_cast<size_t>(end - in);
+    if(rest > 0) {
+        unsigned int value = static_cast<unsigned int>(in[0]) << 16;
+        if(rest == 2) {
+            value |= static_cast<unsigned int>(in[1]) << 8;
+        }
+        *cur++ = alphabet[(value >> 18) & 0x3F];
+        *cur++ = alphabet[(value >> 12) & 0x3F];
+        if(rest == 2) {
+            *cur++ = alphabet[(value >> 6) & 0x3F];
+        }
+        else if(!url) {
+            *cur++ = '=';
+        }
+        if(!url) {
+            *cur++ = '=';
+        }
+    }
+    return static_cast<size_t>(cur - out);
+}
+
+size_t base64DecodedMaxSize(size_t size)
+{
+    return (size + 3) / 4 * 3;
+}
+
+/**
+ * @brief Decode base64 or base64url text.
+ * @param data Input characters.
+ * @param size Input size.
+ * @param out Output buffer, at least base64DecodedMaxSize() bytes.
+ * @param outSize Number of decoded bytes.
+ * @return false if input has characters outside of alphabet.
+ */
+bool base64Decode(const char *data, size_t size, unsigned char *out,
+                  size_t &outSize)
+{
+    // Strip padding
+    while(size > 0 && data[size - 1] == '=') {
+        --size;
+    }
+
+    const char *in = data;
+    const char *end = data + size;
+    unsigned char *cur = out;
+
+#ifdef NGSTD_BASE64_SSSE3
+    if(hasSSSE3()) {
+        cur += decodeSSSE3(in, size, cur);
+    }
+#endif // NGSTD_BASE64_SSSE3
+
+    const unsigned char *table = decodeTable.values;
+    while(end - in >= 4) {
+        unsigned char a = table[static_cast<unsigned char>(in[0])];
+        unsigned char b = table[static_cast<unsigned char>(in[1])];
+        unsigned char c = table[static_cast<unsigned char>(in[2])];
+        unsigned char d = table[static_cast<unsigned char>(in[3])];
+        if((a | b | c | d) == invalidChar) {
+            return false;
+        }
+        unsigned int value = (static_cast<unsigned int>(a) << 18) |
+                (static_cast<unsigned int>(b) << 12) |
+                (static_cast<unsigned int>(c) << 6) | d;
+        *cur++ = static_cast<unsigned char>(value >> 16);
+        *cur++ = static_cast<unsigned char>(value >> 8);
+        *cur++ = static_cast<unsigned char>(value);
+        in += 4;
+    }
+
+    size_t rest = static_cast<size_t>(end - in);
+    if(rest == 1) {
+        return false;
+    }
+    if(rest > 1) {
+        unsigned char a = table[static_cast<unsigned char>(in[0])];
+        unsigned char b = table[static_cast<unsigned char>(in[1])];
+        unsigned char c = rest == 3 ? table[static_cast<unsigned char>(in[2])] : 0;
+        if((a | b | c) == invalidChar) {
+            return false;
+        }
+        unsigned int value = (static_cast<unsigned int>(a) << 18) |
+                (static_cast<unsigned int>(b) << 12) |
+                (static_cast<unsigned int>(c) << 6);
+        *cur++ = static_cast<unsigned char>(value >> 16);
+        if(rest == 3) {
+            *cur++ = static_cast<unsigned char>(value >> 8);
+        }
+    }
+
+    outSize = static_cast<size_t>(cur - out);
+    return true;
+}
+
+/**
+ * @brief Decode base64 or base64url text skipping characters outside of
+ * alphabet, i.e. line breaks or inner padding. Trailing bits which do not
+ * form a whole byte are ignored.
+ * @param data Input characters.
+ * @param size Input size.
+ * @param out Output buffer, at least base64DecodedMaxSize() bytes.
+ * @return Number of decoded bytes.
+ */
+size_t base64DecodeLenient(const char *data, size_t size, unsigned char *out)
+{
+    size_t outSize = 0;
+    if(base64Decode(data, size, out, outSize)) {
+        return outSize;
+    }
+
+    const unsigned char *table = decodeTable.values;
+    unsigned char *cur = out;
+    unsigned int value = 0;
+    int bits = 0;
+    for(const char *in = data; in != data + size; ++in) {
+        unsigned char index = table[static_cast<unsigned char>(*in)];
+        if(index == invalidChar) {
+            continue;
+        }
+        value = (value << 6) | index;
+        bits += 6;
+        if(bits >= 8) {
+            bits -= 8;
+            *cur++ = static_cast<unsigned char>(value >> bits);
+        }
+    }
+    return static_cast<size_t>(cur - out);
+}
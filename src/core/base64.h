@@ -0,0 +1,36 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGSTD_BASE64_H
+#define NGSTD_BASE64_H
+
+#include <cstddef>
+
+// Base64 codec working on raw buffers. Encoding with url = true uses base64url
+// alphabet ("-" and "_") without padding. Decoding accepts both alphabets and
+// optional padding. Lenient decoding skips characters outside of alphabet as
+// CPLBase64DecodeInPlace does.
+size_t base64EncodedSize(size_t size, bool url);
+size_t base64Encode(const unsigned char *data, size_t size, char *out, bool url);
+size_t base64DecodedMaxSize(size_t size);
+bool base64Decode(const char *data, size_t size, unsigned char *out,
+                  size_t &outSize);
+size_t base64DecodeLenient(const char *data, size_t size, unsigned char *out);
+
+#endif // NGSTD_BASE64_H
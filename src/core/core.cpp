@@ -20,10 +20,16 @@
 #include "core/core.h"
 
 #include "core/version.h"
+#include "core/base64.h"
+#include "core/cplbridge.h"
+#include "core/mappedfile.h"
 #include "core/util.h"
 
 #include "cpl_json.h"
 #include "cpl_string.h"
+#include "cpl_vsi.h"
+
+#include <climits>
 
 const char* getVersion()
 {
@@ -31,48 +37,131 @@ const char* getVersion()
 }
 
 QMap<QString, QVariant> memJsonToMap(const QString &str) {
-    CPLJSONDocument in;
-    if(in.LoadMemory(str.toStdString())) {
-        return toMap(in.GetRoot());
+    QByteArray data = str.toUtf8();
+    return bufferToMap(data.constData(), static_cast<size_t>(data.size()));
+}
+
+QMap<QString, QVariant> memJsonToMap(const QString &str, const QStringList &keys) {
+    QByteArray data = str.toUtf8();
+    return bufferToMap(data.constData(), static_cast<size_t>(data.size()), keys);
+}
+
+// GDAL virtual file systems (/vsizip/, /vsicurl/ and others) are not visible
+// to QFile, such paths are read with VSI API
+static bool isVSIPath(const QString &path)
+{
+    return path.startsWith(QLatin1String("/vsi"));
+}
+
+static bool readVSIFile(const QString &path, QByteArray &out)
+{
+    VSILFILE *file = VSIFOpenL(Utf8(path), "rb");
+    if(file == nullptr) {
+        return false;
     }
-    return QMap<QString, QVariant>();
+    bool result = false;
+    if(VSIFSeekL(file, 0, SEEK_END) == 0) {
+        vsi_l_offset size = VSIFTellL(file);
+        // QByteArray size is int
+        if(size <= INT_MAX && VSIFSeekL(file, 0, SEEK_SET) == 0) {
+            out.resize(static_cast<int>(size));
+            result = VSIFReadL(out.data(), 1, static_cast<size_t>(size), file) ==
+                    static_cast<size_t>(size);
+        }
+    }
+    VSIFCloseL(file);
+    return result;
 }
 
 QMap<QString, QVariant> jsonToMap(const QString &path)
 {
-    CPLJSONDocument in;
-    if(in.Load(path.toStdString())) {
-        return toMap(in.GetRoot());
+    if(isVSIPath(path)) {
+        QByteArray data;
+        if(!readVSIFile(path, data)) {
+            return QMap<QString, QVariant>();
+        }
+        return bufferToMap(data.constData(), static_cast<size_t>(data.size()));
+    }
+
+    MappedFile file(path);
+    if(!file.isValid()) {
+        return QMap<QString, QVariant>();
+    }
+    file.adviseSequential();
+    return bufferToMap(file.data(), file.size());
+}
+
+QMap<QString, QVariant> jsonToMap(const QString &path, const QStringList &keys)
+{
+    if(isVSIPath(path)) {
+        QByteArray data;
+        if(!readVSIFile(path, data)) {
+            return QMap<QString, QVariant>();
+        }
+        return bufferToMap(data.constData(), static_cast<size_t>(data.size()),
+                           keys);
+    }
+
+    MappedFile file(path);
+    if(!file.isValid()) {
+        return QMap<QString, QVariant>();
     }
-    return QMap<QString, QVariant>();
+    file.adviseSequential();
+    return bufferToMap(file.data(), file.size(), keys);
 }
 
 QString fromBase64(const QString &str) {
-//    Replaces “+” by “-” (minus)
-//    Replaces “/” by “_” (underline)
+//    Accepts both base64 and base64url (“-” and “_”) alphabets
 //    Does not require a padding character
-//    Forbids line separators
-
-    QString cpy(str);
-    cpy = cpy.replace("-", "+").replace("_", "/");
-    GByte *base64 = reinterpret_cast<GByte*>(CPLStrdup(cpy.toStdString().c_str()));
-    int length = CPLBase64DecodeInPlace(base64);
-    std::string out(reinterpret_cast<const char*>(base64), length);
-    CPLFree(base64);
-    return QString::fromStdString(out);
+//    Skips line separators and other characters outside of alphabet
+    QByteArray data = str.toLatin1();
+    QByteArray out(static_cast<int>(base64DecodedMaxSize(data.size())),
+                   Qt::Uninitialized);
+    size_t size = base64DecodeLenient(data.constData(),
+                                      static_cast<size_t>(data.size()),
+                                      reinterpret_cast<unsigned char*>(out.data()));
+    out.resize(static_cast<int>(size));
+    return QString::fromUtf8(out);
 }
 
 QString toBase64(unsigned char *data, int size) {
-    char* base64new = CPLBase64Encode(size, data);
-    QString out(base64new);
-    CPLFree(base64new);
-    out = out.replace("+", "-").replace("/", "_").replace("=", "");
+    if(size <= 0) {
+        return QString();
+    }
+    QByteArray out(static_cast<int>(base64EncodedSize(size, true)),
+                   Qt::Uninitialized);
+    base64Encode(data, static_cast<size_t>(size), out.data(), true);
+    return QString::fromLatin1(out);
+}
+
+QByteArray fromBase64Url(const QByteArray &data)
+{
+//    Strict: returns empty array if data has characters outside of base64 or
+//    base64url alphabet, including line separators
+
+    QByteArray out(static_cast<int>(base64DecodedMaxSize(data.size())),
+                   Qt::Uninitialized);
+    size_t size = 0;
+    if(!base64Decode(data.constData(), static_cast<size_t>(data.size()),
+                     reinterpret_cast<unsigned char*>(out.data()), size)) {
+        return QByteArray();
+    }
+    out.resize(static_cast<int>(size));
+    return out;
+}
+
+QByteArray toBase64Url(const QByteArray &data)
+{
+    QByteArray out(static_cast<int>(base64EncodedSize(data.size(), true)),
+                   Qt::Uninitialized);
+    base64Encode(reinterpret_cast<const unsigned char*>(data.constData()),
+                 static_cast<size_t>(data.size()), out.data(), true);
     return out;
 }
 
 QString unescapeUrl(const QString &str)
 {
-    char* unescaped = CPLUnescapeString(str.toStdString().c_str(), nullptr, CPLES_URL);
+    char* unescaped = CPLUnescapeString(Utf8(str), nullptr, CPLES_URL);
     QString out(unescaped);
     CPLFree(unescaped);
     return out;
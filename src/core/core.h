@@ -22,6 +22,7 @@
 
 #include <QtCore/QtGlobal>
 
+#include <QStringList>
 #include <QVariant>
 
 #if defined(NGSTD_CORE_LIBRARY)
@@ -37,9 +38,15 @@
 
 NGCORE_EXPORT const char *getVersion();
 NGCORE_EXPORT QMap<QString, QVariant> jsonToMap(const QString &path);
+NGCORE_EXPORT QMap<QString, QVariant> jsonToMap(const QString &path,
+                                                 const QStringList &keys);
 NGCORE_EXPORT QMap<QString, QVariant> memJsonToMap(const QString &path);
+NGCORE_EXPORT QMap<QString, QVariant> memJsonToMap(const QString &str,
+                                                    const QStringList &keys);
 NGCORE_EXPORT QString fromBase64(const QString &str);
 NGCORE_EXPORT QString toBase64(unsigned char *data, int size);
+NGCORE_EXPORT QByteArray fromBase64Url(const QByteArray &data);
+NGCORE_EXPORT QByteArray toBase64Url(const QByteArray &data);
 NGCORE_EXPORT QString unescapeUrl(const QString &str);
 
 #endif // NGSTD_CORE_H
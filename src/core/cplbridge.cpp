@@ -0,0 +1,165 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/cplbridge.h"
+
+#include "cpl_string.h"
+
+#include <cstring>
+
+static bool appendText(char *&cur, char *last, const char *text, size_t size)
+{
+    if(static_cast<size_t>(last - cur) < size) {
+        return false;
+    }
+    memcpy(cur, text, size);
+    cur += size;
+    return true;
+}
+
+static bool appendPart(char *&cur, char *last, const CPLOptionPart &part)
+{
+    if(part.text) {
+        return appendText(cur, last, part.text, strlen(part.text));
+    }
+    int size = utf8Encode(*part.str, cur, static_cast<int>(last - cur));
+    if(size < 0) {
+        return false;
+    }
+    cur += size;
+    return true;
+}
+
+CPLOptions::CPLOptions() :
+    m_list(m_items),
+    m_count(0),
+    m_used(0)
+{
+    m_items[0] = nullptr;
+}
+
+CPLOptions::CPLOptions(const char * const *base) :
+    m_list(m_items),
+    m_count(0),
+    m_used(0)
+{
+    m_items[0] = nullptr;
+    for(; base && *base; ++base) {
+        appendItem(*base);
+    }
+}
+
+void CPLOptions::set(const char *key, const char *value)
+{
+    CPLOptionPart part(value);
+    setParts(key, &part, 1);
+}
+
+void CPLOptions::set(const char *key, const QString &value)
+{
+    CPLOptionPart part(value);
+    setParts(key, &part, 1);
+}
+
+/**
+ * @brief Set option value concatenated from several parts. Existing option
+ * with the same key is replaced.
+ * @param key Option key.
+ * @param parts Value parts.
+ */
+void CPLOptions::set(const char *key,
+                     std::initializer_list<CPLOptionPart> parts)
+{
+    setParts(key, parts.begin(), parts.size());
+}
+
+void CPLOptions::setParts(const char *key, const CPLOptionPart *parts,
+                          size_t count)
+{
+    const CPLOptionPart *end = parts + count;
+    char *start = m_arena + m_used;
+    char *cur = start;
+    char *last = m_arena + arenaSize - 1; // Space for terminating zero
+    bool fits = appendText(cur, last, key, strlen(key)) &&
+            appendText(cur, last, "=", 1);
+    for(const CPLOptionPart *it = parts; fits && it != end; ++it) {
+        fits = appendPart(cur, last, *it);
+    }
+
+    if(fits) {
+        *cur++ = 0;
+        m_used += static_cast<size_t>(cur - start);
+        setItem(key, start);
+        return;
+    }
+
+    std::string item(key);
+    item += '=';
+    for(const CPLOptionPart *it = parts; it != end; ++it) {
+        if(it->text) {
+            item += it->text;
+        }
+        else {
+            QByteArray utf8 = it->str->toUtf8();
+            item.append(utf8.constData(), static_cast<size_t>(utf8.size()));
+        }
+    }
+    m_heap.push_back(std::move(item));
+    setItem(key, m_heap.back().c_str());
+}
+
+const char *CPLOptions::value(const char *key) const
+{
+    return CSLFetchNameValue(const_cast<char**>(m_list), key);
+}
+
+void CPLOptions::setItem(const char *key, const char *item)
+{
+    size_t keySize = strlen(key);
+    for(int i = 0; i < m_count; ++i) {
+        if(EQUALN(m_list[i], key, keySize) && m_list[i][keySize] == '=') {
+            m_list[i] = item;
+            return;
+        }
+    }
+    appendItem(item);
+}
+
+void CPLOptions::appendItem(const char *item)
+{
+    if(m_list == m_items && m_count < maxItems) {
+        m_items[m_count++] = item;
+        m_items[m_count] = nullptr;
+        return;
+    }
+
+    // Stack list is full, move it to heap
+    if(m_list == m_items) {
+        m_heapItems.reserve(maxItems * 2);
+        m_heapItems.assign(m_items, m_items + m_count);
+    }
+    else {
+        m_heapItems.pop_back(); // Terminating null
+    }
+    m_heapItems.push_back(item);
+    m_heapItems.push_back(nullptr);
+    m_list = m_heapItems.data();
+    ++m_count;
+}
@@ -0,0 +1,198 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGSTD_CPLBRIDGE_H
+#define NGSTD_CPLBRIDGE_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <initializer_list>
+#include <list>
+#include <string>
+#include <vector>
+
+// CPLHTTPFetch option keys
+namespace CPLOption {
+constexpr const char *HEADERS = "HEADERS";
+constexpr const char *CUSTOMREQUEST = "CUSTOMREQUEST";
+constexpr const char *POSTFIELDS = "POSTFIELDS";
+constexpr const char *CONNECTTIMEOUT = "CONNECTTIMEOUT";
+constexpr const char *TIMEOUT = "TIMEOUT";
+constexpr const char *MAX_RETRY = "MAX_RETRY";
+constexpr const char *RETRY_DELAY = "RETRY_DELAY";
+constexpr const char *CAINFO = "CAINFO";
+constexpr const char *NO_BODY = "NO_BODY";
+constexpr const char *FORM_FILE_PATH = "FORM_FILE_PATH";
+constexpr const char *FORM_FILE_NAME = "FORM_FILE_NAME";
+constexpr const char *PERSISTENT = "PERSISTENT";
+constexpr const char *CLOSE_PERSISTENT = "CLOSE_PERSISTENT";
+constexpr const char *PROXY = "PROXY";
+constexpr const char *PROXYUSERPWD = "PROXYUSERPWD";
+constexpr const char *PROXYAUTH = "PROXYAUTH";
+}
+
+/**
+ * @brief Writes UTF-8 representation of string to the buffer. Unpaired
+ * surrogates are replaced with U+FFFD as QString::toUtf8 does.
+ * @param str String to convert.
+ * @param out Output buffer.
+ * @param capacity Output buffer size. Strings of str.size() * 3 bytes always
+ * fit.
+ * @return Number of bytes written (without terminating zero) or -1 if buffer
+ * is too small.
+ */
+inline int utf8Encode(const QString &str, char *out, int capacity)
+{
+    const ushort *in = str.utf16();
+    const ushort *end = in + str.size();
+    char *cur = out;
+    char *last = out + capacity;
+    while(in < end) {
+        uint code = *in++;
+        if(code < 0x80) {
+            if(cur >= last) {
+                return -1;
+            }
+            *cur++ = static_cast<char>(code);
+            continue;
+        }
+
+        if(code >= 0xD800 && code < 0xE000) {
+            if(code < 0xDC00 && in < end && *in >= 0xDC00 && *in < 0xE000) {
+                code = 0x10000 + ((code - 0xD800) << 10) + (*in++ - 0xDC00);
+            }
+            else {
+                code = 0xFFFD;
+            }
+        }
+
+        if(code < 0x800) {
+            if(last - cur < 2) {
+                return -1;
+            }
+            *cur++ = static_cast<char>(0xC0 | (code >> 6));
+        }
+        else if(code < 0x10000) {
+            if(last - cur < 3) {
+                return -1;
+            }
+            *cur++ = static_cast<char>(0xE0 | (code >> 12));
+            *cur++ = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        }
+        else {
+            if(last - cur < 4) {
+                return -1;
+            }
+            *cur++ = static_cast<char>(0xF0 | (code >> 18));
+            *cur++ = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            *cur++ = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        }
+        *cur++ = static_cast<char>(0x80 | (code & 0x3F));
+    }
+    return static_cast<int>(cur - out);
+}
+
+/**
+ * @brief The Utf8 class holds zero terminated UTF-8 copy of the string for
+ * passing to C API. Short strings are converted into the stack buffer, long
+ * ones fall back to QByteArray.
+ */
+class Utf8
+{
+public:
+    explicit Utf8(const QString &str) {
+        int size = utf8Encode(str, m_buffer, stackSize - 1);
+        if(size >= 0) {
+            m_buffer[size] = 0;
+            m_data = m_buffer;
+            m_size = size;
+        }
+        else {
+            m_heap = str.toUtf8();
+            m_data = m_heap.constData();
+            m_size = m_heap.size();
+        }
+    }
+    Utf8(const Utf8 &) = delete;
+    Utf8 &operator=(const Utf8 &) = delete;
+
+    const char *data() const { return m_data; }
+    int size() const { return m_size; }
+    operator const char *() const { return m_data; }
+
+private:
+    enum { stackSize = 512 };
+    char m_buffer[stackSize];
+    QByteArray m_heap;
+    const char *m_data;
+    int m_size;
+};
+
+/**
+ * @brief The CPLOptionPart class is a part of option value. It refers to
+ * either Latin-1/UTF-8 text or QString converted in place.
+ */
+struct CPLOptionPart
+{
+    CPLOptionPart(const char *text) : text(text), str(nullptr) {}
+    CPLOptionPart(const QString &str) : text(nullptr), str(&str) {}
+    const char *text;
+    const QString *str;
+};
+
+/**
+ * @brief The CPLOptions class is a string list for CPL functions options. Base
+ * entries are referenced without copying, new entries are stored in the stack
+ * arena. Only very long values (i.e. big POST payloads) and lists of more than
+ * 32 entries are allocated on heap. The list must outlive the call it is passed
+ * to.
+ */
+class CPLOptions
+{
+public:
+    CPLOptions();
+    explicit CPLOptions(const char * const *base);
+    CPLOptions(const CPLOptions &) = delete;
+    CPLOptions &operator=(const CPLOptions &) = delete;
+
+    void set(const char *key, const char *value);
+    void set(const char *key, const QString &value);
+    void set(const char *key, std::initializer_list<CPLOptionPart> parts);
+    const char *value(const char *key) const;
+    int count() const { return m_count; }
+    operator char **() { return const_cast<char**>(m_list); }
+
+private:
+    void setParts(const char *key, const CPLOptionPart *parts, size_t count);
+    void setItem(const char *key, const char *item);
+    void appendItem(const char *item);
+
+private:
+    enum { maxItems = 32, arenaSize = 4096 };
+    const char *m_items[maxItems + 1];
+    std::vector<const char*> m_heapItems;
+    const char **m_list;
+    int m_count;
+    char m_arena[arenaSize];
+    size_t m_used;
+    std::list<std::string> m_heap;
+};
+
+#endif // NGSTD_CPLBRIDGE_H
@@ -0,0 +1,148 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/executor.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+
+constexpr int defaultThreadCount = 4;
+constexpr const char *threadName = "ngstd-io";
+
+class IOTask : public QRunnable
+{
+public:
+    explicit IOTask(NGIOExecutor *executor, std::function<void()> task) :
+        m_executor(executor), m_task(task) { m_queued.start(); }
+    virtual void run() override;
+
+private:
+    NGIOExecutor *m_executor;
+    std::function<void()> m_task;
+    QElapsedTimer m_queued;
+};
+
+void IOTask::run()
+{
+    QThread *thread = QThread::currentThread();
+    if(thread->objectName().isEmpty()) {
+        thread->setObjectName(QLatin1String(threadName));
+    }
+    m_executor->taskStarted(m_queued.nsecsElapsed() / 1000);
+    m_task();
+    m_executor->taskFinished();
+}
+
+NGIOExecutor::NGIOExecutor() :
+    m_queued(0),
+    m_active(0),
+    m_peakQueued(0),
+    m_submitted(0),
+    m_completed(0)
+{
+    m_pool.setMaxThreadCount(defaultThreadCount);
+}
+
+NGIOExecutor &NGIOExecutor::instance()
+{
+    static NGIOExecutor executor;
+    return executor;
+}
+
+/**
+ * @brief Queue task for execution.
+ * @param task Function to run.
+ */
+void NGIOExecutor::start(std::function<void()> task)
+{
+    m_submitted++;
+    int queued = ++m_queued;
+    int peak = m_peakQueued;
+    while(queued > peak && !m_peakQueued.compare_exchange_weak(peak, queued)) {
+    }
+    m_pool.start(new IOTask(this, task));
+}
+
+/**
+ * @brief Set maximum number of threads. Tasks block on network, so the count
+ * does not depend on number of CPU cores. Default is 4.
+ */
+void NGIOExecutor::setMaxThreadCount(int count)
+{
+    m_pool.setMaxThreadCount(qMax(1, count));
+}
+
+int NGIOExecutor::maxThreadCount() const
+{
+    return m_pool.maxThreadCount();
+}
+
+/**
+ * @brief Number of tasks waiting for free thread.
+ */
+int NGIOExecutor::queueDepth() const
+{
+    return m_queued;
+}
+
+int NGIOExecutor::activeCount() const
+{
+    return m_active;
+}
+
+/**
+ * @brief Executor statistics. Wait time is in microseconds.
+ * @return map with threads, queued, peak_queued, active, submitted, completed
+ * and wait histogram.
+ */
+QVariantMap NGIOExecutor::stats() const
+{
+    QVariantMap out;
+    out["threads"] = m_pool.maxThreadCount();
+    out["queued"] = m_queued.load();
+    out["peak_queued"] = m_peakQueued.load();
+    out["active"] = m_active.load();
+    out["submitted"] = m_submitted.load();
+    out["completed"] = m_completed.load();
+    QMutexLocker locker(&m_mutex);
+    out["wait"] = m_wait.toMap();
+    return out;
+}
+
+bool NGIOExecutor::waitForDone(int msecs)
+{
+    return m_pool.waitForDone(msecs);
+}
+
+void NGIOExecutor::taskStarted(qint64 waitUsec)
+{
+    m_queued--;
+    m_active++;
+    QMutexLocker locker(&m_mutex);
+    m_wait.add(waitUsec);
+}
+
+void NGIOExecutor::taskFinished()
+{
+    m_active--;
+    m_completed++;
+}
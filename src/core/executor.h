@@ -0,0 +1,113 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGCORE_EXECUTOR_H
+#define NGCORE_EXECUTOR_H
+
+#include "core/metrics.h"
+
+#include <QFuture>
+#include <QFutureInterface>
+#include <QMutex>
+#include <QThreadPool>
+#include <QVariant>
+
+#include <atomic>
+#include <functional>
+
+namespace NGExecutorPrivate {
+template<typename Result, typename Function>
+struct Call {
+    static void run(QFutureInterface<Result> &future, Function &function) {
+        future.reportResult(function());
+    }
+};
+
+template<typename Function>
+struct Call<void, Function> {
+    static void run(QFutureInterface<void> &, Function &function) {
+        function();
+    }
+};
+}
+
+/**
+ * @brief The NGIOExecutor class runs library background work (network and
+ * file I/O) on its own thread pool, so blocking tasks do not occupy
+ * QThreadPool::globalInstance() used by application for computations. Thread
+ * count is bounded, extra tasks wait in queue. Queue depth, active tasks and
+ * queue wait time are collected for monitoring.
+ */
+class NGCORE_EXPORT NGIOExecutor
+{
+public:
+    static NGIOExecutor &instance();
+
+    void start(std::function<void()> task);
+    template<typename Function>
+    auto run(Function function) -> QFuture<decltype(function())>;
+
+    void setMaxThreadCount(int count);
+    int maxThreadCount() const;
+    int queueDepth() const;
+    int activeCount() const;
+    QVariantMap stats() const;
+    bool waitForDone(int msecs = -1);
+
+private:
+    NGIOExecutor();
+    NGIOExecutor(const NGIOExecutor &) = delete;
+    NGIOExecutor &operator= (const NGIOExecutor &) = delete;
+
+private:
+    friend class IOTask;
+    void taskStarted(qint64 waitUsec);
+    void taskFinished();
+
+private:
+    QThreadPool m_pool;
+    std::atomic<int> m_queued;
+    std::atomic<int> m_active;
+    std::atomic<int> m_peakQueued;
+    std::atomic<qint64> m_submitted;
+    std::atomic<qint64> m_completed;
+    mutable QMutex m_mutex;
+    NGHistogram m_wait;
+};
+
+/**
+ * @brief Run function on executor.
+ * @param function Callable without arguments.
+ * @return Future with function result.
+ */
+template<typename Function>
+auto NGIOExecutor::run(Function function) -> QFuture<decltype(function())>
+{
+    typedef decltype(function()) Result;
+    QFutureInterface<Result> future;
+    future.reportStarted();
+    QFuture<Result> out = future.future();
+    start([future, function]() mutable {
+        NGExecutorPrivate::Call<Result, Function>::run(future, function);
+        future.reportFinished();
+    });
+    return out;
+}
+
+#endif // NGCORE_EXECUTOR_H
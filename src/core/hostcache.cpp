@@ -0,0 +1,84 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/hostcache.h"
+
+#include <QMutexLocker>
+
+NGHostCache::NGHostCache() :
+    m_ttl(10000)
+{
+
+}
+
+NGHostCache &NGHostCache::instance()
+{
+    static NGHostCache cache;
+    return cache;
+}
+
+/**
+ * @brief Check if host failed to resolve recently. Never resolves.
+ * @param host Host name.
+ * @return true if host is cached as unresolvable.
+ */
+bool NGHostCache::isUnresolvable(const QString &host) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.constFind(host);
+    return it != m_entries.constEnd() && !it.value().hasExpired(m_ttl);
+}
+
+/**
+ * @brief Cache resolve failure reported by other resolver (i.e. curl).
+ * @param host Host name.
+ */
+void NGHostCache::setUnresolvable(const QString &host)
+{
+    QElapsedTimer updated;
+    updated.start();
+    QMutexLocker locker(&m_mutex);
+    m_entries[host] = updated;
+}
+
+void NGHostCache::remove(const QString &host)
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.remove(host);
+}
+
+/**
+ * @brief Remove all entries, for example, when network configuration changes.
+ */
+void NGHostCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+}
+
+/**
+ * @brief Set how long host is considered unresolvable. Default is 10 seconds.
+ * @param msec Lifetime in milliseconds, 0 disables cache.
+ */
+void NGHostCache::setTTL(int msec)
+{
+    QMutexLocker locker(&m_mutex);
+    m_ttl = msec;
+}
@@ -0,0 +1,58 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGCORE_HOSTCACHE_H
+#define NGCORE_HOSTCACHE_H
+
+#include "core/core.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+
+/**
+ * @brief The NGHostCache class is process wide negative host name resolution
+ * cache. Hosts which failed to resolve are kept for TTL, so NGRequest fails
+ * fast instead of waiting for resolver timeout on each request. Cache is
+ * cleared when network configuration changes. Successful resolutions are
+ * cached by libcurl.
+ */
+class NGCORE_EXPORT NGHostCache
+{
+public:
+    static NGHostCache &instance();
+
+    bool isUnresolvable(const QString &host) const;
+    void setUnresolvable(const QString &host);
+    void remove(const QString &host);
+    void clear();
+    void setTTL(int msec);
+
+private:
+    NGHostCache();
+    NGHostCache(const NGHostCache &) = delete;
+    NGHostCache &operator= (const NGHostCache &) = delete;
+
+private:
+    mutable QMutex m_mutex;
+    QHash<QString, QElapsedTimer> m_entries;
+    int m_ttl;
+};
+
+#endif // NGCORE_HOSTCACHE_H
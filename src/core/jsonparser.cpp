@@ -0,0 +1,723 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/jsonparser.h"
+
+#include "core/jsonutil.h"
+
+#include "cpl_conv.h"
+
+// std
+#include <climits>
+#include <cstring>
+
+// SSE2 is the x86-64 baseline and is used unconditionally there. Scanning for
+// quotes, backslashes and control characters needs only byte compares, so
+// SSE4.2 string instructions would not be faster. The AVX2 kernel is selected
+// at runtime on GCC/Clang x86 builds, as base64 SSSE3 kernels are.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define NGSTD_JSON_SSE2
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#   include <immintrin.h>
+#   define NGSTD_JSON_AVX2
+#   define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
+constexpr int maxDepth = 512;
+constexpr int maxNumberLength = 64;
+
+static inline int firstSetBit(unsigned int mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+static inline bool isStringSpecial(char c)
+{
+    return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+#ifdef NGSTD_JSON_AVX2
+
+static bool hasAVX2()
+{
+    static const bool result = __builtin_cpu_supports("avx2");
+    return result;
+}
+
+// Returns pointer to the first quote, backslash or control character in
+// [p, end) or position where less than 32 bytes are left.
+AVX2_TARGET
+static const char *findStringSpecialAVX2(const char *p, const char *end)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i ctrl = _mm256_set1_epi8(0x1F);
+    while(end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i special = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+                                    _mm256_cmpeq_epi8(chunk, backslash)),
+                    _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, ctrl), chunk));
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(special));
+        if(mask != 0) {
+            return p + firstSetBit(mask);
+        }
+        p += 32;
+    }
+    return p;
+}
+
+#endif // NGSTD_JSON_AVX2
+
+// Returns pointer to the first quote, backslash or control character in
+// [p, end) or end if there is none.
+static const char *findStringSpecial(const char *p, const char *end)
+{
+#if defined(NGSTD_JSON_AVX2)
+    if(hasAVX2()) {
+        p = findStringSpecialAVX2(p, end);
+    }
+#endif
+#if defined(NGSTD_JSON_SSE2)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1F);
+    while(end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i special = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                 _mm_cmpeq_epi8(chunk, backslash)),
+                    _mm_cmpeq_epi8(_mm_min_epu8(chunk, ctrl), chunk));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(special));
+        if(mask != 0) {
+            return p + firstSetBit(mask);
+        }
+        p += 16;
+    }
+#endif
+    while(p < end && !isStringSpecial(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+JSONParser::JSONParser(const char *data, size_t size) :
+    m_begin(data),
+    m_cur(data),
+    m_end(data + size)
+{
+    // Skip UTF-8 BOM
+    if(size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+        m_cur += 3;
+    }
+}
+
+QString JSONParser::errorMessage() const
+{
+    return m_error;
+}
+
+bool JSONParser::setError(const char *message)
+{
+    m_error = QString("%1 at offset %2").arg(message).arg(m_cur - m_begin);
+    return false;
+}
+
+void JSONParser::skipWhitespace()
+{
+    while(m_cur < m_end && (*m_cur == ' ' || *m_cur == '\n' ||
+                            *m_cur == '\r' || *m_cur == '\t')) {
+        ++m_cur;
+    }
+}
+
+bool JSONParser::expect(char c)
+{
+    skipWhitespace();
+    if(m_cur >= m_end || *m_cur != c) {
+        return setError("Unexpected character");
+    }
+    ++m_cur;
+    return true;
+}
+
+bool JSONParser::parse(QMap<QString, QVariant> &out)
+{
+    skipWhitespace();
+    if(m_cur >= m_end || *m_cur != '{') {
+        return setError("Root is not an object");
+    }
+    if(!parseObject(out, 1)) {
+        return false;
+    }
+    skipWhitespace();
+    if(m_cur != m_end) {
+        return setError("Unexpected data after root object");
+    }
+    return true;
+}
+
+/**
+ * @brief Parse document and convert only values found by the paths. Values
+ * of other keys are skipped without conversion.
+ * @param out Map of path - value pairs.
+ * @param paths Slash separated key sequences, i.e. "resource_access/client/roles".
+ * @return true on success.
+ */
+bool JSONParser::parse(QMap<QString, QVariant> &out, const QStringList &paths)
+{
+    std::vector<Selector> selectors;
+    selectors.reserve(static_cast<size_t>(paths.size()));
+    for(const QString &path : paths) {
+        Selector selector;
+        selector.path = path;
+        for(const QString &segment : path.split(QLatin1Char('/'), QString::SkipEmptyParts)) {
+            selector.segments.push_back(segment.toUtf8());
+        }
+        if(!selector.segments.empty()) {
+            selectors.push_back(selector);
+        }
+    }
+
+    Selectors active;
+    active.reserve(selectors.size());
+    for(const Selector &selector : selectors) {
+        active.push_back(&selector);
+    }
+
+    skipWhitespace();
+    if(m_cur >= m_end || *m_cur != '{') {
+        return setError("Root is not an object");
+    }
+    if(!selectObject(out, active, 0, 1)) {
+        return false;
+    }
+    skipWhitespace();
+    if(m_cur != m_end) {
+        return setError("Unexpected data after root object");
+    }
+    return true;
+}
+
+bool JSONParser::selectObject(QMap<QString, QVariant> &out,
+                              const Selectors &selectors, size_t level,
+                              int depth)
+{
+    if(depth > maxDepth) {
+        return setError("Too deep nesting");
+    }
+
+    ++m_cur; // {
+    skipWhitespace();
+    if(m_cur < m_end && *m_cur == '}') {
+        ++m_cur;
+        return true;
+    }
+
+    Selectors complete, nested;
+    while(true) {
+        skipWhitespace();
+        if(m_cur >= m_end || *m_cur != '"') {
+            return setError("Expected object key");
+        }
+        const char *key;
+        int keySize;
+        if(!readString(key, keySize)) {
+            return false;
+        }
+
+        complete.clear();
+        nested.clear();
+        for(const Selector *selector : selectors) {
+            const QByteArray &segment = selector->segments[level];
+            if(segment.size() == keySize &&
+                    memcmp(segment.constData(), key, static_cast<size_t>(keySize)) == 0) {
+                if(level + 1 == selector->segments.size()) {
+                    complete.push_back(selector);
+                }
+                else {
+                    nested.push_back(selector);
+                }
+            }
+        }
+
+        if(!expect(':')) {
+            return false;
+        }
+        skipWhitespace();
+
+        if(!complete.empty()) {
+            QVariant value;
+            if(!parseValue(value, depth)) {
+                return false;
+            }
+            for(const Selector *selector : complete) {
+                out.insert(selector->path, value);
+            }
+            // Paths pointing inside the value just parsed
+            for(const Selector *selector : nested) {
+                QVariant child = value;
+                size_t i = level + 1;
+                for(; i < selector->segments.size(); ++i) {
+                    if(child.type() != QVariant::Map) {
+                        break;
+                    }
+                    QVariantMap map = child.toMap();
+                    auto it = map.constFind(QString::fromUtf8(selector->segments[i]));
+                    if(it == map.constEnd()) {
+                        break;
+                    }
+                    child = it.value();
+                }
+                if(i == selector->segments.size()) {
+                    out.insert(selector->path, child);
+                }
+            }
+        }
+        else if(!nested.empty() && m_cur < m_end && *m_cur == '{') {
+            if(!selectObject(out, nested, level + 1, depth + 1)) {
+                return false;
+            }
+        }
+        else if(!skipValue(depth)) {
+            return false;
+        }
+
+        skipWhitespace();
+        if(m_cur >= m_end) {
+            return setError("Unexpected end of data");
+        }
+        if(*m_cur == ',') {
+            ++m_cur;
+            continue;
+        }
+        if(*m_cur == '}') {
+            ++m_cur;
+            return true;
+        }
+        return setError("Expected ',' or '}'");
+    }
+}
+
+bool JSONParser::parseValue(QVariant &out, int depth)
+{
+    skipWhitespace();
+    if(m_cur >= m_end) {
+        return setError("Unexpected end of data");
+    }
+
+    switch(*m_cur) {
+    case '{':
+    {
+        QVariantMap map;
+        if(!parseObject(map, depth + 1)) {
+            return false;
+        }
+        out = map;
+        return true;
+    }
+    case '[':
+    {
+        QVariantList list;
+        if(!parseArray(list, depth + 1)) {
+            return false;
+        }
+        out = list;
+        return true;
+    }
+    case '"':
+    {
+        const char *data;
+        int size;
+        if(!readString(data, size)) {
+            return false;
+        }
+        out = QString::fromUtf8(data, size);
+        return true;
+    }
+    case 't':
+        if(!readLiteral("true", 4)) {
+            return false;
+        }
+        out = true;
+        return true;
+    case 'f':
+        if(!readLiteral("false", 5)) {
+            return false;
+        }
+        out = false;
+        return true;
+    case 'n':
+        if(!readLiteral("null", 4)) {
+            return false;
+        }
+        out = QVariant();
+        return true;
+    default:
+        return parseNumber(out);
+    }
+}
+
+bool JSONParser::parseObject(QVariantMap &out, int depth)
+{
+    if(depth > maxDepth) {
+        return setError("Too deep nesting");
+    }
+
+    ++m_cur; // {
+    skipWhitespace();
+    if(m_cur < m_end && *m_cur == '}') {
+        ++m_cur;
+        return true;
+    }
+
+    while(true) {
+        skipWhitespace();
+        if(m_cur >= m_end || *m_cur != '"') {
+            return setError("Expected object key");
+        }
+        const char *key;
+        int keySize;
+        if(!readString(key, keySize)) {
+            return false;
+        }
+        QString name = QString::fromUtf8(key, keySize);
+        if(!expect(':')) {
+            return false;
+        }
+        QVariant value;
+        if(!parseValue(value, depth)) {
+            return false;
+        }
+        out.insert(name, value);
+
+        skipWhitespace();
+        if(m_cur >= m_end) {
+            return setError("Unexpected end of data");
+        }
+        if(*m_cur == ',') {
+            ++m_cur;
+            continue;
+        }
+        if(*m_cur == '}') {
+            ++m_cur;
+            return true;
+        }
+        return setError("Expected ',' or '}'");
+    }
+}
+
+bool JSONParser::parseArray(QVariantList &out, int depth)
+{
+    if(depth > maxDepth) {
+        return setError("Too deep nesting");
+    }
+
+    ++m_cur; // [
+    skipWhitespace();
+    if(m_cur < m_end && *m_cur == ']') {
+        ++m_cur;
+        return true;
+    }
+
+    while(true) {
+        QVariant value;
+        if(!parseValue(value, depth)) {
+            return false;
+        }
+        out.append(value);
+
+        skipWhitespace();
+        if(m_cur >= m_end) {
+            return setError("Unexpected end of data");
+        }
+        if(*m_cur == ',') {
+            ++m_cur;
+            continue;
+        }
+        if(*m_cur == ']') {
+            ++m_cur;
+            return true;
+        }
+        return setError("Expected ',' or ']'");
+    }
+}
+
+bool JSONParser::parseNumber(QVariant &out)
+{
+    const char *start = m_cur;
+    bool isFloat = false;
+    const char *numberEnd = scanNumber(m_cur, m_end, isFloat);
+    if(!numberEnd) {
+        return setError("Invalid value");
+    }
+    m_cur = numberEnd;
+    const char *digits = *start == '-' ? start + 1 : start;
+
+    if(!isFloat) {
+        bool negative = *start == '-';
+        unsigned long long value = 0;
+        bool overflow = false;
+        for(const char *p = digits; p < m_cur; ++p) {
+            unsigned int digit = static_cast<unsigned int>(*p - '0');
+            if(value > (ULLONG_MAX - digit) / 10) {
+                overflow = true;
+                break;
+            }
+            value = value * 10 + digit;
+        }
+
+        const unsigned long long limit = static_cast<unsigned long long>(LLONG_MAX);
+        if(!overflow && value <= limit + (negative ? 1 : 0)) {
+            qlonglong number = negative ?
+                        -static_cast<qlonglong>(value - 1) - 1 :
+                        static_cast<qlonglong>(value);
+            if(number >= INT_MIN && number <= INT_MAX) {
+                out = static_cast<int>(number);
+            }
+            else {
+                out = number;
+            }
+            return true;
+        }
+        // Does not fit into 64 bit integer, fall back to double
+    }
+
+    // CPLStrtod is locale independent, but needs zero terminated string
+    size_t size = static_cast<size_t>(m_cur - start);
+    if(size < maxNumberLength) {
+        char buffer[maxNumberLength];
+        memcpy(buffer, start, size);
+        buffer[size] = '\0';
+        out = CPLStrtod(buffer, nullptr);
+    }
+    else {
+        std::string buffer(start, size);
+        out = CPLStrtod(buffer.c_str(), nullptr);
+    }
+    return true;
+}
+
+bool JSONParser::readLiteral(const char *literal, int size)
+{
+    if(m_end - m_cur < size || memcmp(m_cur, literal, static_cast<size_t>(size)) != 0) {
+        return setError("Invalid literal");
+    }
+    m_cur += size;
+    return true;
+}
+
+/**
+ * @brief Read string at current position. If string has no escape sequences
+ * the output points directly into the input buffer, otherwise into internal
+ * buffer valid until next read.
+ */
+bool JSONParser::readString(const char *&data, int &size)
+{
+    ++m_cur; // "
+    const char *start = m_cur;
+    const char *special = findStringSpecial(m_cur, m_end);
+    if(special < m_end && *special == '"') {
+        if(special - start > INT_MAX) {
+            return setError("String is too long");
+        }
+        data = start;
+        size = static_cast<int>(special - start);
+        m_cur = special + 1;
+        return true;
+    }
+
+    m_buffer.assign(start, special);
+    m_cur = special;
+    while(m_cur < m_end) {
+        char c = *m_cur;
+        if(c == '"') {
+            if(m_buffer.size() > INT_MAX) {
+                return setError("String is too long");
+            }
+            ++m_cur;
+            data = m_buffer.data();
+            size = static_cast<int>(m_buffer.size());
+            return true;
+        }
+        if(c == '\\') {
+            ++m_cur;
+            unsigned int cp;
+            if(!decodeEscape(m_cur, m_end, cp)) {
+                return setError("Invalid escape sequence");
+            }
+            appendUtf8(m_buffer, cp);
+            continue;
+        }
+        if(static_cast<unsigned char>(c) < 0x20) {
+            return setError("Control character in string");
+        }
+        const char *next = findStringSpecial(m_cur, m_end);
+        m_buffer.append(m_cur, next);
+        m_cur = next;
+    }
+    return setError("Unterminated string");
+}
+
+bool JSONParser::skipString()
+{
+    ++m_cur; // "
+    while(true) {
+        m_cur = findStringSpecial(m_cur, m_end);
+        if(m_cur >= m_end) {
+            return setError("Unterminated string");
+        }
+        char c = *m_cur;
+        if(c == '"') {
+            ++m_cur;
+            return true;
+        }
+        if(c != '\\') {
+            return setError("Control character in string");
+        }
+        ++m_cur;
+        unsigned int cp;
+        if(!decodeEscape(m_cur, m_end, cp)) {
+            return setError("Invalid escape sequence");
+        }
+    }
+}
+
+/**
+ * @brief Skip value at current position. The value is validated as strictly
+ * as parsed ones, but nothing is converted.
+ */
+bool JSONParser::skipValue(int depth)
+{
+    skipWhitespace();
+    if(m_cur >= m_end) {
+        return setError("Unexpected end of data");
+    }
+
+    switch(*m_cur) {
+    case '{':
+        return skipObject(depth + 1);
+    case '[':
+        return skipArray(depth + 1);
+    case '"':
+        return skipString();
+    case 't':
+        return readLiteral("true", 4);
+    case 'f':
+        return readLiteral("false", 5);
+    case 'n':
+        return readLiteral("null", 4);
+    default:
+    {
+        bool isFloat;
+        const char *numberEnd = scanNumber(m_cur, m_end, isFloat);
+        if(!numberEnd) {
+            return setError("Invalid value");
+        }
+        m_cur = numberEnd;
+        return true;
+    }
+    }
+}
+
+bool JSONParser::skipObject(int depth)
+{
+    if(depth > maxDepth) {
+        return setError("Too deep nesting");
+    }
+
+    ++m_cur; // {
+    skipWhitespace();
+    if(m_cur < m_end && *m_cur == '}') {
+        ++m_cur;
+        return true;
+    }
+
+    while(true) {
+        skipWhitespace();
+        if(m_cur >= m_end || *m_cur != '"') {
+            return setError("Expected object key");
+        }
+        if(!skipString() || !expect(':') || !skipValue(depth)) {
+            return false;
+        }
+
+        skipWhitespace();
+        if(m_cur >= m_end) {
+            return setError("Unexpected end of data");
+        }
+        if(*m_cur == ',') {
+            ++m_cur;
+            continue;
+        }
+        if(*m_cur == '}') {
+            ++m_cur;
+            return true;
+        }
+        return setError("Expected ',' or '}'");
+    }
+}
+
+bool JSONParser::skipArray(int depth)
+{
+    if(depth > maxDepth) {
+        return setError("Too deep nesting");
+    }
+
+    ++m_cur; // [
+    skipWhitespace();
+    if(m_cur < m_end && *m_cur == ']') {
+        ++m_cur;
+        return true;
+    }
+
+    while(true) {
+        if(!skipValue(depth)) {
+            return false;
+        }
+
+        skipWhitespace();
+        if(m_cur >= m_end) {
+            return setError("Unexpected end of data");
+        }
+        if(*m_cur == ',') {
+            ++m_cur;
+            continue;
+        }
+        if(*m_cur == ']') {
+            ++m_cur;
+            return true;
+        }
+        return setError("Expected ',' or ']'");
+    }
+}
@@ -0,0 +1,77 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGSTD_JSONPARSER_H
+#define NGSTD_JSONPARSER_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief The JSONParser class is a single pass JSON to QVariant parser working
+ * directly on a memory buffer. String scanning uses SSE2 on x86-64, AVX2 when
+ * the CPU supports it and a scalar loop otherwise. Documents are validated
+ * strictly by RFC 8259 grammar, including values skipped by path selection.
+ */
+class JSONParser
+{
+public:
+    explicit JSONParser(const char *data, size_t size);
+    bool parse(QMap<QString, QVariant> &out);
+    bool parse(QMap<QString, QVariant> &out, const QStringList &paths);
+    QString errorMessage() const;
+
+private:
+    struct Selector {
+        std::vector<QByteArray> segments;
+        QString path;
+    };
+    typedef std::vector<const Selector*> Selectors;
+
+    bool parseValue(QVariant &out, int depth);
+    bool parseObject(QVariantMap &out, int depth);
+    bool parseArray(QVariantList &out, int depth);
+    bool parseNumber(QVariant &out);
+    bool readString(const char *&data, int &size);
+    bool readLiteral(const char *literal, int size);
+    bool selectObject(QMap<QString, QVariant> &out, const Selectors &selectors,
+                      size_t level, int depth);
+    bool skipValue(int depth);
+    bool skipObject(int depth);
+    bool skipArray(int depth);
+    bool skipString();
+    bool expect(char c);
+    void skipWhitespace();
+    bool setError(const char *message);
+
+private:
+    const char *m_begin;
+    const char *m_cur;
+    const char *m_end;
+    std::string m_buffer;
+    QString m_error;
+};
+
+#endif // NGSTD_JSONPARSER_H
@@ -0,0 +1,447 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/jsonreader.h"
+
+#include "core/jsonutil.h"
+#include "core/mappedfile.h"
+
+#include "cpl_conv.h"
+
+// std
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+
+constexpr size_t maxDepth = 512;
+constexpr size_t readChunkSize = 1024 * 1024;
+constexpr unsigned char utf8Bom[] = { 0xEF, 0xBB, 0xBF };
+
+static inline bool isWhitespace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline bool isNumberChar(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+            c == 'e' || c == 'E';
+}
+
+// Decode raw string content (without quotes) with escape sequences.
+static bool unescape(const std::string &in, std::string &out)
+{
+    out.clear();
+    out.reserve(in.size());
+    const char *p = in.data();
+    const char *end = p + in.size();
+    while(p < end) {
+        char c = *p++;
+        if(static_cast<unsigned char>(c) < 0x20) {
+            return false;
+        }
+        if(c != '\\') {
+            out += c;
+            continue;
+        }
+        unsigned int cp;
+        if(!decodeEscape(p, end, cp)) {
+            return false;
+        }
+        appendUtf8(out, cp);
+    }
+    return true;
+}
+
+NGJsonStreamReader::NGJsonStreamReader(NGJsonHandler *handler) :
+    m_handler(handler),
+    m_state(State::Value),
+    m_token(Token::None),
+    m_isKey(false),
+    m_escape(false),
+    m_failed(false),
+    m_bom(0),
+    m_offset(0),
+    m_chunk(nullptr),
+    m_pos(nullptr)
+{
+}
+
+void NGJsonStreamReader::reset()
+{
+    m_state = State::Value;
+    m_token = Token::None;
+    m_isKey = false;
+    m_escape = false;
+    m_failed = false;
+    m_bom = 0;
+    m_offset = 0;
+    m_stack.clear();
+    m_buffer.clear();
+    m_error.clear();
+}
+
+bool NGJsonStreamReader::hasError() const
+{
+    return m_failed;
+}
+
+QString NGJsonStreamReader::errorMessage() const
+{
+    return m_error;
+}
+
+bool NGJsonStreamReader::setError(const char *message)
+{
+    size_t offset = m_offset;
+    if(m_chunk != nullptr && m_pos != nullptr) {
+        offset += static_cast<size_t>(m_pos - m_chunk);
+    }
+    m_error = QString("%1 at offset %2").arg(message).arg(offset);
+    m_failed = true;
+    return false;
+}
+
+bool NGJsonStreamReader::call(bool result)
+{
+    if(!result) {
+        m_error = QLatin1String("Stopped by handler");
+        m_failed = true;
+    }
+    return result;
+}
+
+/**
+ * @brief Feed next chunk of document.
+ * @param data Chunk data. Chunk boundaries may split any token.
+ * @param size Chunk size in bytes.
+ * @return false on parse error or if handler stopped reading.
+ */
+bool NGJsonStreamReader::feed(const char *data, size_t size)
+{
+    if(m_failed) {
+        return false;
+    }
+
+    const char *end = data + size;
+    m_chunk = data;
+    m_pos = data;
+    while(m_pos < end) {
+        if(m_token == Token::String) {
+            const char *start = m_pos;
+            while(m_pos < end) {
+                char c = *m_pos;
+                if(static_cast<unsigned char>(c) < 0x20) {
+                    return setError("Control character in string");
+                }
+                if(m_escape) {
+                    m_escape = false;
+                }
+                else if(c == '\\') {
+                    m_escape = true;
+                }
+                else if(c == '"') {
+                    break;
+                }
+                ++m_pos;
+            }
+            m_buffer.append(start, m_pos);
+            if(m_pos == end) {
+                break; // Wait for next chunk
+            }
+            ++m_pos; // Closing quote
+            m_token = Token::None;
+            if(!onString()) {
+                return false;
+            }
+            continue;
+        }
+
+        if(m_token == Token::Number || m_token == Token::Literal) {
+            const char *start = m_pos;
+            if(m_token == Token::Number) {
+                while(m_pos < end && isNumberChar(*m_pos)) {
+                    ++m_pos;
+                }
+            }
+            else {
+                while(m_pos < end && *m_pos >= 'a' && *m_pos <= 'z') {
+                    ++m_pos;
+                }
+            }
+            m_buffer.append(start, m_pos);
+            if(m_pos == end) {
+                break; // Wait for next chunk
+            }
+            bool result = m_token == Token::Number ? onNumber() : onLiteral();
+            m_token = Token::None;
+            if(!result) {
+                return false;
+            }
+            continue; // Delimiter is processed as next character
+        }
+
+        char c = *m_pos;
+        // UTF-8 byte order mark is allowed before document, may be split
+        // between chunks
+        if(m_bom < 3 && m_offset + static_cast<size_t>(m_pos - data) ==
+                static_cast<size_t>(m_bom)) {
+            if(static_cast<unsigned char>(c) == utf8Bom[m_bom]) {
+                ++m_bom;
+                ++m_pos;
+                continue;
+            }
+            if(m_bom > 0) {
+                return setError("Invalid byte order mark");
+            }
+            m_bom = 3;
+        }
+        if(!isWhitespace(c) && !onChar(c)) {
+            return false;
+        }
+        ++m_pos;
+    }
+
+    m_offset += size;
+    m_chunk = m_pos = nullptr;
+    return true;
+}
+
+/**
+ * @brief Signal end of document. Flushes pending token and checks document is
+ * complete.
+ * @return true if whole document was read successfully.
+ */
+bool NGJsonStreamReader::finish()
+{
+    if(m_failed) {
+        return false;
+    }
+
+    if(m_token == Token::Number || m_token == Token::Literal) {
+        bool result = m_token == Token::Number ? onNumber() : onLiteral();
+        m_token = Token::None;
+        if(!result) {
+            return false;
+        }
+    }
+    if(m_token == Token::String) {
+        return setError("Unterminated string");
+    }
+    if(m_state != State::Done) {
+        return setError("Unexpected end of data");
+    }
+    return true;
+}
+
+bool NGJsonStreamReader::expectsValue() const
+{
+    return m_state == State::Value || m_state == State::ValueOrEnd;
+}
+
+bool NGJsonStreamReader::afterValue()
+{
+    m_state = m_stack.empty() ? State::Done : State::CommaOrEnd;
+    return true;
+}
+
+bool NGJsonStreamReader::onChar(char c)
+{
+    if(m_state == State::Done) {
+        return setError("Unexpected data after root value");
+    }
+
+    switch(c) {
+    case '{':
+    case '[':
+        if(!expectsValue()) {
+            return setError("Unexpected character");
+        }
+        if(m_stack.size() >= maxDepth) {
+            return setError("Too deep nesting");
+        }
+        m_stack.push_back(c);
+        m_state = c == '{' ? State::KeyOrEnd : State::ValueOrEnd;
+        return call(c == '{' ? m_handler->startObject() : m_handler->startArray());
+    case '}':
+        if((m_state != State::KeyOrEnd && m_state != State::CommaOrEnd) ||
+                m_stack.empty() || m_stack.back() != '{') {
+            return setError("Unexpected character");
+        }
+        m_stack.pop_back();
+        afterValue();
+        return call(m_handler->endObject());
+    case ']':
+        if((m_state != State::ValueOrEnd && m_state != State::CommaOrEnd) ||
+                m_stack.empty() || m_stack.back() != '[') {
+            return setError("Unexpected character");
+        }
+        m_stack.pop_back();
+        afterValue();
+        return call(m_handler->endArray());
+    case ':':
+        if(m_state != State::Colon) {
+            return setError("Unexpected character");
+        }
+        m_state = State::Value;
+        return true;
+    case ',':
+        if(m_state != State::CommaOrEnd) {
+            return setError("Unexpected character");
+        }
+        m_state = m_stack.back() == '{' ? State::Key : State::Value;
+        return true;
+    case '"':
+        if(m_state == State::Key || m_state == State::KeyOrEnd) {
+            m_isKey = true;
+        }
+        else if(expectsValue()) {
+            m_isKey = false;
+        }
+        else {
+            return setError("Unexpected character");
+        }
+        m_token = Token::String;
+        m_escape = false;
+        m_buffer.clear();
+        return true;
+    default:
+        if(!expectsValue()) {
+            return setError("Unexpected character");
+        }
+        if(c == '-' || (c >= '0' && c <= '9')) {
+            m_token = Token::Number;
+        }
+        else if(c == 't' || c == 'f' || c == 'n') {
+            m_token = Token::Literal;
+        }
+        else {
+            return setError("Invalid value");
+        }
+        m_buffer.assign(1, c);
+        return true;
+    }
+}
+
+bool NGJsonStreamReader::onString()
+{
+    std::string decoded;
+    const std::string *text = &m_buffer;
+    if(m_buffer.find('\\') != std::string::npos) {
+        if(!unescape(m_buffer, decoded)) {
+            return setError("Invalid string");
+        }
+        text = &decoded;
+    }
+
+    QString str = QString::fromUtf8(text->data(), static_cast<int>(text->size()));
+    if(m_isKey) {
+        m_state = State::Colon;
+        return call(m_handler->key(str));
+    }
+    afterValue();
+    return call(m_handler->value(str));
+}
+
+bool NGJsonStreamReader::onNumber()
+{
+    const char *str = m_buffer.c_str();
+    bool isFloat = false;
+    if(scanNumber(str, str + m_buffer.size(), isFloat) != str + m_buffer.size()) {
+        return setError("Invalid number");
+    }
+
+    char *end = nullptr;
+    QVariant value;
+    if(!isFloat) {
+        errno = 0;
+        long long number = strtoll(str, &end, 10);
+        if(errno == ERANGE) {
+            value = CPLStrtod(str, &end);
+        }
+        else if(number >= INT_MIN && number <= INT_MAX) {
+            value = static_cast<int>(number);
+        }
+        else {
+            value = static_cast<qlonglong>(number);
+        }
+    }
+    else {
+        value = CPLStrtod(str, &end);
+    }
+
+    if(end != str + m_buffer.size()) {
+        return setError("Invalid number");
+    }
+    afterValue();
+    return call(m_handler->value(value));
+}
+
+bool NGJsonStreamReader::onLiteral()
+{
+    QVariant value;
+    if(m_buffer == "true") {
+        value = true;
+    }
+    else if(m_buffer == "false") {
+        value = false;
+    }
+    else if(m_buffer != "null") {
+        return setError("Invalid literal");
+    }
+    afterValue();
+    return call(m_handler->value(value));
+}
+
+/**
+ * @brief Read json file and pass events to handler. The file is memory mapped
+ * and already parsed pages are released, so memory usage stays low for files
+ * of any size.
+ * @param path File path.
+ * @param handler Events handler.
+ * @param error Optional output error message.
+ * @return true on success.
+ */
+bool NGJsonStreamReader::readFile(const QString &path, NGJsonHandler *handler,
+                                  QString *error)
+{
+    MappedFile file(path);
+    if(!file.isValid()) {
+        if(error) {
+            *error = QString("Failed open file %1").arg(path);
+        }
+        return false;
+    }
+    file.adviseSequential();
+
+    NGJsonStreamReader reader(handler);
+    bool result = true;
+    for(size_t offset = 0; result && offset < file.size(); offset += readChunkSize) {
+        size_t size = qMin(readChunkSize, file.size() - offset);
+        result = reader.feed(file.data() + offset, size);
+        file.release(offset + size);
+    }
+    result = result && reader.finish();
+
+    if(!result && error) {
+        *error = reader.errorMessage();
+    }
+    return result;
+}
@@ -0,0 +1,95 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGCORE_JSONREADER_H
+#define NGCORE_JSONREADER_H
+
+#include "core/core.h"
+
+#include <QString>
+#include <QVariant>
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief The NGJsonHandler class receives events from NGJsonStreamReader.
+ * Return false from any callback to stop reading.
+ */
+class NGCORE_EXPORT NGJsonHandler
+{
+public:
+    virtual ~NGJsonHandler() = default;
+    virtual bool startObject() { return true; }
+    virtual bool endObject() { return true; }
+    virtual bool startArray() { return true; }
+    virtual bool endArray() { return true; }
+    virtual bool key(const QString &name) { Q_UNUSED(name) return true; }
+    virtual bool value(const QVariant &value) { Q_UNUSED(value) return true; }
+};
+
+/**
+ * @brief The NGJsonStreamReader class is an incremental (push) json parser.
+ * Data may be fed by chunks of any size, events are emitted as soon as tokens
+ * are complete. Memory usage does not depend on document size, only on
+ * nesting depth and the longest single token.
+ */
+class NGCORE_EXPORT NGJsonStreamReader
+{
+public:
+    explicit NGJsonStreamReader(NGJsonHandler *handler);
+    bool feed(const char *data, size_t size);
+    bool finish();
+    void reset();
+    bool hasError() const;
+    QString errorMessage() const;
+
+    static bool readFile(const QString &path, NGJsonHandler *handler,
+                         QString *error = nullptr);
+
+private:
+    enum class State { Value, ValueOrEnd, Key, KeyOrEnd, Colon, CommaOrEnd, Done };
+    enum class Token { None, String, Number, Literal };
+
+    bool onChar(char c);
+    bool onString();
+    bool onNumber();
+    bool onLiteral();
+    bool afterValue();
+    bool expectsValue() const;
+    bool setError(const char *message);
+    bool call(bool result);
+
+private:
+    NGJsonHandler *m_handler;
+    State m_state;
+    Token m_token;
+    bool m_isKey;
+    bool m_escape;
+    bool m_failed;
+    int m_bom; // Byte order mark bytes skipped
+    size_t m_offset;
+    const char *m_chunk;
+    const char *m_pos;
+    std::vector<char> m_stack;
+    std::string m_buffer;
+    QString m_error;
+};
+
+#endif // NGCORE_JSONREADER_H
@@ -0,0 +1,181 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGSTD_JSONUTIL_H
+#define NGSTD_JSONUTIL_H
+
+#include <string>
+
+// JSON grammar helpers shared by JSONParser and NGJsonStreamReader
+
+inline void appendUtf8(std::string &out, unsigned int cp)
+{
+    if(cp < 0x80) {
+        out += static_cast<char>(cp);
+    }
+    else if(cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if(cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+inline bool readHex(const char *&p, const char *end, unsigned int &out)
+{
+    if(end - p < 4) {
+        return false;
+    }
+    out = 0;
+    for(int i = 0; i < 4; ++i) {
+        char c = p[i];
+        out <<= 4;
+        if(c >= '0' && c <= '9') {
+            out |= static_cast<unsigned int>(c - '0');
+        }
+        else if(c >= 'a' && c <= 'f') {
+            out |= static_cast<unsigned int>(c - 'a' + 10);
+        }
+        else if(c >= 'A' && c <= 'F') {
+            out |= static_cast<unsigned int>(c - 'A' + 10);
+        }
+        else {
+            return false;
+        }
+    }
+    p += 4;
+    return true;
+}
+
+/**
+ * @brief Decode escape sequence. Unpaired surrogates are replaced with U+FFFD.
+ * @param p Position after backslash, moved past the sequence.
+ * @param end End of data.
+ * @param cp Decoded code point.
+ * @return false if sequence is invalid or truncated.
+ */
+inline bool decodeEscape(const char *&p, const char *end, unsigned int &cp)
+{
+    if(p >= end) {
+        return false;
+    }
+    char c = *p++;
+    switch(c) {
+    case '"': cp = '"'; return true;
+    case '\\': cp = '\\'; return true;
+    case '/': cp = '/'; return true;
+    case 'b': cp = '\b'; return true;
+    case 'f': cp = '\f'; return true;
+    case 'n': cp = '\n'; return true;
+    case 'r': cp = '\r'; return true;
+    case 't': cp = '\t'; return true;
+    case 'u':
+        if(!readHex(p, end, cp)) {
+            return false;
+        }
+        if(cp >= 0xD800 && cp <= 0xDBFF) {
+            unsigned int low = 0;
+            if(end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                p += 2;
+                if(!readHex(p, end, low)) {
+                    return false;
+                }
+            }
+            if(low >= 0xDC00 && low <= 0xDFFF) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            }
+            else {
+                cp = 0xFFFD;
+            }
+        }
+        else if(cp >= 0xDC00 && cp <= 0xDFFF) {
+            cp = 0xFFFD;
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Scan number by JSON grammar: optional minus, integer part without
+ * leading zeros, optional fraction and exponent with at least one digit each.
+ * @param p Start of number.
+ * @param end End of data.
+ * @param isFloat Set if number has fraction or exponent.
+ * @return Pointer past the number or nullptr if number is invalid.
+ */
+inline const char *scanNumber(const char *p, const char *end, bool &isFloat)
+{
+    isFloat = false;
+    if(p < end && *p == '-') {
+        ++p;
+    }
+    if(p >= end) {
+        return nullptr;
+    }
+    if(*p == '0') {
+        ++p;
+    }
+    else if(*p >= '1' && *p <= '9') {
+        while(p < end && *p >= '0' && *p <= '9') {
+            ++p;
+        }
+    }
+    else {
+        return nullptr;
+    }
+
+    if(p < end && *p == '.') {
+        isFloat = true;
+        const char *digits = ++p;
+        while(p < end && *p >= '0' && *p <= '9') {
+            ++p;
+        }
+        if(p == digits) {
+            return nullptr;
+        }
+    }
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        isFloat = true;
+        ++p;
+        if(p < end && (*p == '+' || *p == '-')) {
+            ++p;
+        }
+        const char *digits = p;
+        while(p < end && *p >= '0' && *p <= '9') {
+            ++p;
+        }
+        if(p == digits) {
+            return nullptr;
+        }
+    }
+    return p;
+}
+
+#endif // NGSTD_JSONUTIL_H
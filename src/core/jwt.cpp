@@ -0,0 +1,183 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/jwt.h"
+
+#include <QCryptographicHash>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <ctime>
+
+#include "core/base64.h"
+#include "core/util.h"
+
+constexpr int maxCachedTokens = 16;
+
+static QMutex gJWTMutex;
+static QHash<QByteArray, QSharedPointer<const QVariantMap>> gJWTCache;
+
+static QSharedPointer<const QVariantMap> decodeClaims(const QByteArray &token)
+{
+    // header.payload.signature
+    int first = token.indexOf('.');
+    int second = first < 0 ? -1 : token.indexOf('.', first + 1);
+    if(second < 0 || second == first + 1 || second == token.size() - 1 ||
+            token.indexOf('.', second + 1) >= 0) {
+        return QSharedPointer<const QVariantMap>();
+    }
+
+    const char *payload = token.constData() + first + 1;
+    size_t payloadSize = static_cast<size_t>(second - first - 1);
+    QByteArray json(static_cast<int>(base64DecodedMaxSize(payloadSize)),
+                    Qt::Uninitialized);
+    size_t jsonSize = 0;
+    if(!base64Decode(payload, payloadSize,
+                     reinterpret_cast<unsigned char*>(json.data()), jsonSize)) {
+        return QSharedPointer<const QVariantMap>();
+    }
+
+    QVariantMap claims = bufferToMap(json.constData(), jsonSize);
+    if(claims.isEmpty()) {
+        return QSharedPointer<const QVariantMap>();
+    }
+    return QSharedPointer<const QVariantMap>(new QVariantMap(claims));
+}
+
+NGJWT::NGJWT()
+{
+
+}
+
+NGJWT::NGJWT(QSharedPointer<const QVariantMap> claims) :
+    m_claims(claims)
+{
+
+}
+
+/**
+ * @brief Decode token payload. Repeated calls with the same token return
+ * cached claims. Invalid tokens are cached too.
+ * @param token Access token.
+ * @return NGJWT instance, check isValid() before use.
+ */
+NGJWT NGJWT::decode(const QString &token)
+{
+    if(token.isEmpty()) {
+        return NGJWT();
+    }
+
+    QByteArray data = token.toLatin1();
+    QByteArray key = QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+    {
+        QMutexLocker locker(&gJWTMutex);
+        auto it = gJWTCache.constFind(key);
+        if(it != gJWTCache.constEnd()) {
+            return NGJWT(it.value());
+        }
+    }
+
+    auto claims = decodeClaims(data);
+
+    QMutexLocker locker(&gJWTMutex);
+    // Only few tokens are alive at the same time, old ones are never used again
+    if(gJWTCache.size() >= maxCachedTokens) {
+        gJWTCache.clear();
+    }
+    gJWTCache.insert(key, claims);
+    return NGJWT(claims);
+}
+
+bool NGJWT::isValid() const
+{
+    return !m_claims.isNull();
+}
+
+QString NGJWT::sub() const
+{
+    return value("sub").toString();
+}
+
+/**
+ * @brief Expiration time claim.
+ * @return Seconds since epoch or 0 if token has no exp claim.
+ */
+qint64 NGJWT::exp() const
+{
+    return value("exp").toLongLong();
+}
+
+QVariantMap NGJWT::resourceAccess() const
+{
+    return value("resource_access").toMap();
+}
+
+QStringList NGJWT::roles(const QString &clientId) const
+{
+    return resourceAccess().value(clientId).toMap().value("roles").toStringList();
+}
+
+/**
+ * @brief Check if token is expired. Invalid tokens and tokens without exp
+ * claim are never expired.
+ * @param leeway Seconds to subtract from expiration time.
+ * @return true if token is expired.
+ */
+bool NGJWT::isExpired(int leeway) const
+{
+    qint64 expTime = exp();
+    if(expTime == 0) {
+        return false;
+    }
+    return static_cast<qint64>(time(nullptr)) + leeway >= expTime;
+}
+
+/**
+ * @brief Claim value by slash separated path, for example
+ * "resource_access/client/roles".
+ * @param path Claim path.
+ * @return Claim value or invalid QVariant.
+ */
+QVariant NGJWT::value(const QString &path) const
+{
+    if(!m_claims) {
+        return QVariant();
+    }
+
+    const QStringList parts = path.split(QLatin1Char('/'), QString::SkipEmptyParts);
+    if(parts.isEmpty()) {
+        return QVariant();
+    }
+
+    QVariant current = m_claims->value(parts.first());
+    for(int i = 1; i < parts.size(); ++i) {
+        if(current.type() != QVariant::Map) {
+            return QVariant();
+        }
+        current = current.toMap().value(parts[i]);
+    }
+    return current;
+}
+
+QVariantMap NGJWT::claims() const
+{
+    return m_claims ? *m_claims : QVariantMap();
+}
@@ -0,0 +1,56 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGCORE_JWT_H
+#define NGCORE_JWT_H
+
+#include "core/core.h"
+
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVariant>
+
+/**
+ * @brief The NGJWT class gives access to JSON Web Token claims. The payload is
+ * decoded once per token, decoded claims are cached by token hash and shared
+ * between NGJWT instances. The signature is not verified.
+ */
+class NGCORE_EXPORT NGJWT
+{
+public:
+    NGJWT();
+    static NGJWT decode(const QString &token);
+
+    bool isValid() const;
+    QString sub() const;
+    qint64 exp() const;
+    QVariantMap resourceAccess() const;
+    QStringList roles(const QString &clientId) const;
+    bool isExpired(int leeway = 0) const;
+    QVariant value(const QString &path) const;
+    QVariantMap claims() const;
+
+private:
+    explicit NGJWT(QSharedPointer<const QVariantMap> claims);
+
+private:
+    QSharedPointer<const QVariantMap> m_claims;
+};
+
+#endif // NGCORE_JWT_H
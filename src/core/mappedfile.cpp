@@ -0,0 +1,112 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/mappedfile.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif // Q_OS_UNIX
+
+MappedFile::MappedFile(const QString &path) :
+    m_file(path),
+    m_map(nullptr),
+    m_data(nullptr),
+    m_size(0),
+    m_released(0),
+    m_valid(false)
+{
+    if(!m_file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    qint64 fileSize = m_file.size();
+    if(fileSize > 0) {
+        m_map = m_file.map(0, fileSize);
+    }
+
+    if(m_map != nullptr) {
+        m_data = reinterpret_cast<const char*>(m_map);
+        m_size = static_cast<size_t>(fileSize);
+    }
+    else {
+        m_buffer = m_file.readAll();
+        m_data = m_buffer.constData();
+        m_size = static_cast<size_t>(m_buffer.size());
+    }
+    m_valid = true;
+}
+
+MappedFile::~MappedFile()
+{
+    if(m_map != nullptr) {
+        m_file.unmap(m_map);
+    }
+}
+
+bool MappedFile::isValid() const
+{
+    return m_valid;
+}
+
+const char *MappedFile::data() const
+{
+    return m_data;
+}
+
+size_t MappedFile::size() const
+{
+    return m_size;
+}
+
+/**
+ * @brief Hint the kernel that mapping will be read once from begin to end, so
+ * it reads ahead aggressively and may drop pages behind.
+ */
+void MappedFile::adviseSequential()
+{
+#ifdef Q_OS_UNIX
+    if(m_map != nullptr) {
+        madvise(m_map, m_size, MADV_SEQUENTIAL);
+    }
+#endif // Q_OS_UNIX
+}
+
+/**
+ * @brief Drop mapped pages which are fully inside [0, size) range. The data
+ * is still readable, but will be read from disk again on access.
+ * @param size Number of bytes from mapping begin already processed.
+ */
+void MappedFile::release(size_t size)
+{
+#ifdef Q_OS_UNIX
+    if(m_map == nullptr) {
+        return;
+    }
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t end = qMin(size, m_size) / pageSize * pageSize;
+    if(end > m_released) {
+        madvise(m_map + m_released, end - m_released, MADV_DONTNEED);
+        m_released = end;
+    }
+#else
+    Q_UNUSED(size)
+#endif // Q_OS_UNIX
+}
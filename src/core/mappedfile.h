@@ -0,0 +1,52 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGSTD_MAPPEDFILE_H
+#define NGSTD_MAPPEDFILE_H
+
+#include <QByteArray>
+#include <QFile>
+
+/**
+ * @brief The MappedFile class maps file into memory for reading. If mapping
+ * is not possible (i.e. not a regular file) the content is read into heap.
+ */
+class MappedFile
+{
+public:
+    explicit MappedFile(const QString &path);
+    ~MappedFile();
+    bool isValid() const;
+    const char *data() const;
+    size_t size() const;
+    void adviseSequential();
+    void release(size_t size);
+
+private:
+    Q_DISABLE_COPY(MappedFile)
+    QFile m_file;
+    uchar *m_map;
+    QByteArray m_buffer;
+    const char *m_data;
+    size_t m_size;
+    size_t m_released;
+    bool m_valid;
+};
+
+#endif // NGSTD_MAPPEDFILE_H
@@ -0,0 +1,261 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/metrics.h"
+
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QUrl>
+#include <QtAlgorithms>
+
+#include <cmath>
+#include <limits>
+
+// 16 exact buckets for 0 - 15, then 8 buckets for each power of two up to 2^63
+constexpr int exactBuckets = 16;
+constexpr int subBuckets = 8;
+constexpr int bucketCount = exactBuckets + (63 - 4) * subBuckets;
+
+static int bucketIndex(qint64 value)
+{
+    if(value < exactBuckets) {
+        return value < 0 ? 0 : static_cast<int>(value);
+    }
+    int exp = 63 - static_cast<int>(qCountLeadingZeroBits(static_cast<quint64>(value)));
+    int sub = static_cast<int>((value >> (exp - 3)) & (subBuckets - 1));
+    return exactBuckets + (exp - 4) * subBuckets + sub;
+}
+
+static qint64 bucketLowerBound(int index)
+{
+    if(index < exactBuckets) {
+        return index;
+    }
+    int exp = (index - exactBuckets) / subBuckets + 4;
+    int sub = (index - exactBuckets) % subBuckets;
+    return static_cast<qint64>(subBuckets + sub) << (exp - 3);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NGHistogram
+////////////////////////////////////////////////////////////////////////////////
+
+NGHistogram::NGHistogram() :
+    m_buckets(bucketCount, 0),
+    m_count(0),
+    m_sum(0),
+    m_min(std::numeric_limits<qint64>::max()),
+    m_max(0)
+{
+
+}
+
+void NGHistogram::add(qint64 value)
+{
+    if(value < 0) {
+        return;
+    }
+    m_buckets[static_cast<size_t>(bucketIndex(value))]++;
+    m_count++;
+    m_sum += value;
+    m_min = qMin(m_min, value);
+    m_max = qMax(m_max, value);
+}
+
+void NGHistogram::reset()
+{
+    *this = NGHistogram();
+}
+
+qint64 NGHistogram::count() const
+{
+    return m_count;
+}
+
+qint64 NGHistogram::min() const
+{
+    return m_count == 0 ? 0 : m_min;
+}
+
+qint64 NGHistogram::max() const
+{
+    return m_max;
+}
+
+double NGHistogram::mean() const
+{
+    return m_count == 0 ? 0.0 : static_cast<double>(m_sum) / m_count;
+}
+
+/**
+ * @brief Approximate percentile value.
+ * @param percent Percent from 0 to 100.
+ * @return Middle of the bucket holding the percentile, clamped to min/max.
+ */
+qint64 NGHistogram::percentile(double percent) const
+{
+    if(m_count == 0) {
+        return 0;
+    }
+
+    qint64 rank = static_cast<qint64>(std::ceil(percent / 100.0 * m_count));
+    rank = qBound(static_cast<qint64>(1), rank, m_count);
+    qint64 seen = 0;
+    for(int i = 0; i < bucketCount; ++i) {
+        seen += m_buckets[static_cast<size_t>(i)];
+        if(seen >= rank) {
+            qint64 lower = bucketLowerBound(i);
+            qint64 upper = i + 1 < bucketCount ? bucketLowerBound(i + 1) - 1 : lower;
+            return qBound(min(), lower + (upper - lower) / 2, m_max);
+        }
+    }
+    return m_max;
+}
+
+QVariantMap NGHistogram::toMap() const
+{
+    QVariantMap out;
+    out["count"] = m_count;
+    if(m_count > 0) {
+        out["min"] = min();
+        out["max"] = m_max;
+        out["mean"] = mean();
+        out["p50"] = percentile(50);
+        out["p90"] = percentile(90);
+        out["p99"] = percentile(99);
+    }
+    return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NGRequestMetrics
+////////////////////////////////////////////////////////////////////////////////
+
+std::atomic<bool> NGRequestMetrics::m_enabled(false);
+
+NGRequestMetrics &NGRequestMetrics::instance()
+{
+    static NGRequestMetrics metrics;
+    return metrics;
+}
+
+void NGRequestMetrics::setEnabled(bool enabled)
+{
+    m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool NGRequestMetrics::isEnabled()
+{
+    return m_enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Add request result to metrics. Does nothing if metrics are disabled.
+ * @param url Request URL.
+ * @param response Transport response.
+ * @param bytesIn Received body size.
+ * @param bytesOut Sent body size.
+ */
+void NGRequestMetrics::record(const char *url, const NGHTTPResponse &response,
+                              qint64 bytesIn, qint64 bytesOut)
+{
+    if(!isEnabled()) {
+        return;
+    }
+
+    QString name = QUrl(QString::fromUtf8(url)).toString(
+                QUrl::RemoveUserInfo | QUrl::RemovePath | QUrl::RemoveQuery |
+                QUrl::RemoveFragment);
+
+    QMutexLocker locker(&m_mutex);
+    Origin &origin = m_origins[name];
+    origin.requests++;
+    if(!response.isOk()) {
+        origin.errors++;
+    }
+    origin.retries += response.retries;
+    origin.bytesIn += bytesIn;
+    origin.bytesOut += bytesOut;
+    origin.dns.add(response.timings.dns);
+    origin.connect.add(response.timings.connect);
+    origin.tls.add(response.timings.tls);
+    origin.ttfb.add(response.timings.ttfb);
+    origin.total.add(response.timings.total);
+}
+
+void NGRequestMetrics::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_origins.clear();
+}
+
+QStringList NGRequestMetrics::origins() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_origins.keys();
+}
+
+NGRequestMetrics::Origin NGRequestMetrics::origin(const QString &name) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_origins.value(name);
+}
+
+/**
+ * @brief All metrics as map. Latency values are in microseconds, histograms
+ * without samples (phases not reported by transport) are omitted.
+ * @return map of origin - metrics.
+ */
+QVariantMap NGRequestMetrics::toMap() const
+{
+    QMutexLocker locker(&m_mutex);
+    QVariantMap out;
+    for(auto it = m_origins.constBegin(); it != m_origins.constEnd(); ++it) {
+        const Origin &origin = it.value();
+        QVariantMap latency;
+        const QPair<const char*, const NGHistogram*> histograms[] = {
+            qMakePair("dns", &origin.dns),
+            qMakePair("connect", &origin.connect),
+            qMakePair("tls", &origin.tls),
+            qMakePair("ttfb", &origin.ttfb),
+            qMakePair("total", &origin.total)
+        };
+        for(const auto &histogram : histograms) {
+            if(histogram.second->count() > 0) {
+                latency[histogram.first] = histogram.second->toMap();
+            }
+        }
+
+        QVariantMap item;
+        item["requests"] = origin.requests;
+        item["errors"] = origin.errors;
+        item["retries"] = origin.retries;
+        item["bytes_in"] = origin.bytesIn;
+        item["bytes_out"] = origin.bytesOut;
+        item["latency"] = latency;
+        out[it.key()] = item;
+    }
+    return out;
+}
+
+QByteArray NGRequestMetrics::toJson() const
+{
+    return QJsonDocument::fromVariant(toMap()).toJson();
+}
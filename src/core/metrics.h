@@ -0,0 +1,104 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGCORE_METRICS_H
+#define NGCORE_METRICS_H
+
+#include "core/transport.h"
+
+#include <QMap>
+#include <QMutex>
+#include <QStringList>
+#include <QVariant>
+
+#include <atomic>
+#include <vector>
+
+/**
+ * @brief The NGHistogram class is a latency histogram with logarithmic
+ * buckets. Each power of two range is split into 8 linear sub-buckets, so
+ * values are stored with relative error below 12.5%.
+ */
+class NGCORE_EXPORT NGHistogram
+{
+public:
+    NGHistogram();
+    void add(qint64 value);
+    void reset();
+    qint64 count() const;
+    qint64 min() const;
+    qint64 max() const;
+    double mean() const;
+    qint64 percentile(double percent) const;
+    QVariantMap toMap() const;
+
+private:
+    std::vector<qint64> m_buckets;
+    qint64 m_count;
+    qint64 m_sum;
+    qint64 m_min;
+    qint64 m_max;
+};
+
+/**
+ * @brief The NGRequestMetrics class collects per origin (scheme://host:port)
+ * request counters and latency histograms. Collecting is disabled by default,
+ * in disabled state recording costs one atomic load.
+ */
+class NGCORE_EXPORT NGRequestMetrics
+{
+public:
+    struct Origin {
+        qint64 requests = 0;
+        qint64 errors = 0;
+        qint64 retries = 0;
+        qint64 bytesIn = 0;
+        qint64 bytesOut = 0;
+        NGHistogram dns;
+        NGHistogram connect;
+        NGHistogram tls;
+        NGHistogram ttfb;
+        NGHistogram total;
+    };
+
+public:
+    static NGRequestMetrics &instance();
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    void record(const char *url, const NGHTTPResponse &response,
+                qint64 bytesIn, qint64 bytesOut);
+    void reset();
+    QStringList origins() const;
+    Origin origin(const QString &name) const;
+    QVariantMap toMap() const;
+    QByteArray toJson() const;
+
+private:
+    NGRequestMetrics() = default;
+    NGRequestMetrics(const NGRequestMetrics &) = delete;
+    NGRequestMetrics &operator= (const NGRequestMetrics &) = delete;
+
+private:
+    static std::atomic<bool> m_enabled;
+    mutable QMutex m_mutex;
+    QMap<QString, Origin> m_origins;
+};
+
+#endif // NGCORE_METRICS_H
@@ -0,0 +1,312 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/recording.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QMutexLocker>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // Q_OS_UNIX
+
+// std
+#include <chrono>
+#include <thread>
+
+constexpr quint32 logMagic = 0x4E475452; // NGTR
+constexpr quint16 logVersion = 2;
+// Bodies smaller than this are stored as is
+constexpr int compressThreshold = 256;
+
+static void writeResponse(QDataStream &stream, const NGHTTPResponse &response)
+{
+    QByteArray body = response.body();
+    bool compressed = body.size() >= compressThreshold;
+    stream << static_cast<qint32>(response.status)
+           << static_cast<qint32>(response.error)
+           << static_cast<qint32>(response.retries)
+           << response.errorMessage << response.contentType
+           << response.headers << compressed
+           << (compressed ? qCompress(body) : body);
+}
+
+static bool readResponse(QDataStream &stream, quint16 version,
+                         NGHTTPResponse &response)
+{
+    qint32 status, error, retries = 0;
+    bool compressed;
+    QByteArray body;
+    stream >> status >> error;
+    if(version >= 2) {
+        stream >> retries;
+    }
+    stream >> response.errorMessage
+           >> response.contentType >> response.headers >> compressed >> body;
+    if(stream.status() != QDataStream::Ok) {
+        return false;
+    }
+    response.status = status;
+    response.error = error;
+    response.retries = retries;
+    response.setBody(compressed ? qUncompress(body) : body);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NGRecordingTransport
+////////////////////////////////////////////////////////////////////////////////
+
+struct RecordingWriteContext {
+    NGHTTPWriteFunc write;
+    void *arg;
+    QByteArray body;
+};
+
+static bool recordingWrite(const char *data, size_t size, void *arg)
+{
+    RecordingWriteContext *context = static_cast<RecordingWriteContext*>(arg);
+    context->body.append(data, static_cast<int>(size));
+    return context->write(data, size, context->arg);
+}
+
+// Log is readable by owner only from the start, permissions are not changed
+// after content may already be written
+static bool openPrivate(QFile &file)
+{
+#ifdef Q_OS_UNIX
+    int fd = ::open(QFile::encodeName(file.fileName()).constData(),
+                    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if(fd < 0) {
+        return false;
+    }
+    // Mode of open() applies to new files only, existing one is empty now
+    if(fchmod(fd, S_IRUSR | S_IWUSR) != 0 ||
+            !file.open(fd, QIODevice::WriteOnly, QFileDevice::AutoCloseHandle)) {
+        ::close(fd);
+        return false;
+    }
+    return true;
+#else
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    return true;
+#endif // Q_OS_UNIX
+}
+
+/**
+ * @brief Start recording to the file. Existing file is overwritten.
+ * @param transport Transport to execute requests.
+ * @param path Log file path.
+ */
+NGRecordingTransport::NGRecordingTransport(
+        QSharedPointer<IHTTPTransport> transport, const QString &path) :
+    m_transport(transport),
+    m_file(path)
+{
+    if(openPrivate(m_file)) {
+        QDataStream stream(&m_file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << logMagic << logVersion;
+        m_file.flush();
+    }
+    else {
+        qDebug() << "Failed to open traffic log" << path;
+    }
+    m_timer.start();
+}
+
+bool NGRecordingTransport::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+QSharedPointer<IHTTPTransport> NGRecordingTransport::transport() const
+{
+    return m_transport;
+}
+
+NGHTTPResponse NGRecordingTransport::fetch(const char *url, char **options,
+                                           NGHTTPWriteFunc write,
+                                           void *writeArg)
+{
+    NGTrafficRecord record;
+    record.method = requestMethod(options);
+    record.url = QString::fromUtf8(url);
+    record.offset = m_timer.elapsed();
+
+    QElapsedTimer timer;
+    timer.start();
+    if(write) {
+        RecordingWriteContext context = { write, writeArg, QByteArray() };
+        record.response = m_transport->fetch(url, options, recordingWrite,
+                                             &context);
+        record.duration = timer.elapsed();
+        NGHTTPResponse response = record.response;
+        record.response.setBody(context.body);
+        writeRecord(record);
+        return response;
+    }
+
+    record.response = m_transport->fetch(url, options);
+    record.duration = timer.elapsed();
+    writeRecord(record);
+    return record.response;
+}
+
+void NGRecordingTransport::writeRecord(const NGTrafficRecord &record)
+{
+    QMutexLocker locker(&m_mutex);
+    if(!m_file.isOpen()) {
+        return;
+    }
+
+    QDataStream stream(&m_file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << record.offset << record.duration << record.method << record.url;
+    writeResponse(stream, record.response);
+    m_file.flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NGReplayTransport
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Load traffic log.
+ * @param path Log file path.
+ * @param pace Replay speed: 0 - no delays, 1 - recorded timings, 2 - twice
+ * as fast, etc.
+ */
+NGReplayTransport::NGReplayTransport(const QString &path, double pace) :
+    m_startOffset(0),
+    m_count(0),
+    m_pace(pace),
+    m_valid(false)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to open traffic log" << path;
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic;
+    quint16 version;
+    stream >> magic >> version;
+    if(magic != logMagic || version > logVersion) {
+        qDebug() << "Unsupported traffic log" << path;
+        return;
+    }
+
+    while(!stream.atEnd()) {
+        NGTrafficRecord record;
+        stream >> record.offset >> record.duration >> record.method >> record.url;
+        if(!readResponse(stream, version, record.response)) {
+            qDebug() << "Traffic log is truncated" << path;
+            break;
+        }
+        Sequence &sequence = m_records[record.method + QLatin1Char(' ') + record.url];
+        sequence.records.append(record);
+        sequence.next = 0;
+        m_count++;
+    }
+    m_valid = true;
+}
+
+bool NGReplayTransport::isValid() const
+{
+    return m_valid;
+}
+
+int NGReplayTransport::recordCount() const
+{
+    return m_count;
+}
+
+void NGReplayTransport::setPace(double pace)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pace = pace;
+    m_clock.invalidate();
+}
+
+NGHTTPResponse NGReplayTransport::fetch(const char *url, char **options,
+                                        NGHTTPWriteFunc write, void *writeArg)
+{
+    QString key = requestMethod(options) + QLatin1Char(' ') +
+            QString::fromUtf8(url);
+
+    NGTrafficRecord record;
+    double pace;
+    qint64 delay = 0; // us
+    {
+        QMutexLocker locker(&m_mutex);
+        pace = m_pace;
+        auto it = m_records.find(key);
+        if(it == m_records.end()) {
+            NGHTTPResponse response;
+            response.status = 404;
+            response.errorMessage = QLatin1String("HTTP error code : 404");
+            qDebug() << "No recorded response for" << key;
+            return response;
+        }
+        Sequence &sequence = it.value();
+        record = sequence.records[sequence.next];
+        if(sequence.next < sequence.records.size() - 1) {
+            sequence.next++;
+        }
+
+        if(pace > 0.0) {
+            // Replay clock starts with the first request at its recorded
+            // offset. Requests made earlier than recorded wait for their
+            // offset, then all take recorded duration.
+            if(!m_clock.isValid()) {
+                m_clock.start();
+                m_startOffset = record.offset;
+            }
+            qint64 start = static_cast<qint64>(
+                        (record.offset - m_startOffset) * 1000 / pace);
+            delay = qMax(start - m_clock.nsecsElapsed() / 1000, qint64(0)) +
+                    static_cast<qint64>(record.duration * 1000 / pace);
+        }
+    }
+
+    if(delay > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(delay));
+    }
+
+    if(write) {
+        NGHTTPResponse response = record.response;
+        response.setBody(QByteArray());
+        if(record.response.size() > 0 &&
+                !write(record.response.data(), record.response.size(), writeArg)) {
+            response.errorMessage = QLatin1String("Transfer aborted");
+        }
+        return response;
+    }
+    return record.response;
+}
@@ -0,0 +1,102 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGCORE_RECORDING_H
+#define NGCORE_RECORDING_H
+
+#include "core/transport.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSharedPointer>
+
+/**
+ * @brief The NGTrafficRecord class is one request - response pair of traffic
+ * log.
+ */
+struct NGTrafficRecord
+{
+    qint64 offset;   // Request start since recording start, ms
+    qint64 duration; // Request duration, ms
+    QString method;
+    QString url;
+    NGHTTPResponse response;
+};
+
+/**
+ * @brief The NGRecordingTransport class passes requests to other transport and
+ * writes requests, responses and timings to the log file. Request headers and
+ * bodies are not recorded as they hold credentials, but response bodies are
+ * (i.e. tokens), so the log is created readable by owner only.
+ */
+class NGCORE_EXPORT NGRecordingTransport : public IHTTPTransport
+{
+public:
+    explicit NGRecordingTransport(QSharedPointer<IHTTPTransport> transport,
+                                  const QString &path);
+    bool isOpen() const;
+    QSharedPointer<IHTTPTransport> transport() const;
+    virtual NGHTTPResponse fetch(const char *url, char **options,
+                                 NGHTTPWriteFunc write = nullptr,
+                                 void *writeArg = nullptr) override;
+
+private:
+    void writeRecord(const NGTrafficRecord &record);
+
+private:
+    QSharedPointer<IHTTPTransport> m_transport;
+    QMutex m_mutex;
+    QFile m_file;
+    QElapsedTimer m_timer;
+};
+
+/**
+ * @brief The NGReplayTransport class serves responses from the log written by
+ * NGRecordingTransport. Requests are matched by method and URL, repeated
+ * requests get recorded responses in order, the last one is repeated. With
+ * non zero pace responses are not returned earlier than recorded offset (from
+ * the first request) plus duration.
+ */
+class NGCORE_EXPORT NGReplayTransport : public IHTTPTransport
+{
+public:
+    explicit NGReplayTransport(const QString &path, double pace = 0.0);
+    bool isValid() const;
+    int recordCount() const;
+    void setPace(double pace);
+    virtual NGHTTPResponse fetch(const char *url, char **options,
+                                 NGHTTPWriteFunc write = nullptr,
+                                 void *writeArg = nullptr) override;
+
+private:
+    struct Sequence {
+        QList<NGTrafficRecord> records;
+        int next;
+    };
+
+    mutable QMutex m_mutex;
+    QMap<QString, Sequence> m_records;
+    QElapsedTimer m_clock;
+    qint64 m_startOffset;
+    int m_count;
+    double m_pace;
+    bool m_valid;
+};
+
+#endif // NGCORE_RECORDING_H
@@ -21,27 +21,48 @@
 #include "request.h"
 
 #ifdef Q_OS_WIN
-#include <QCoreApplication>
 #include <QDir>
 #endif
 
 #include <QByteArray>
+#include <QCoreApplication>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+#include <QNetworkConfigurationManager>
+#endif // QT_VERSION < 6.0.0
 #include <QNetworkProxy>
 #include <QNetworkProxyFactory>
+#include <QTimer>
 #include <QUrl>
 
 #include "cpl_http.h"
 #include "cpl_json.h"
+#include "cpl_string.h"
 #include "gdal.h"
 #include "gdal_version.h"
 
 // std
 #include <array>
-
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+#include "core/cplbridge.h"
+#include "core/executor.h"
+#include "core/hostcache.h"
+#include "core/jsonreader.h"
+#include "core/jwt.h"
+#include "core/metrics.h"
+#include "core/recording.h"
 #include "core/util.h"
 
+// Guards authorization map. Requests themselves run without lock.
 #if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
 #   include <mutex>
     static std::recursive_mutex gMutex;
@@ -53,17 +74,182 @@
 #   define MUTEX_LOCKER QMutexLocker locker(&gMutex)
 #endif
 
+// Result of the last request executed by the thread, without body
+static thread_local NGHTTPResponse gLastResult;
+static thread_local QString gLastError;
+// Set while the thread refreshes token, so the token request is sent without
+// Authorization header
+static thread_local bool gTokenRefresh = false;
 
-static CPLStringList getOptions(const QString &url) {
-    CPLStringList options(NGRequest::instance().baseOptions());
-    QStringList headers;
 
-    headers.append("Accept: */*");
-    if (!NGRequest::getAuthHeader(url).isNull())
-        headers.append(NGRequest::getAuthHeader(url));
+static void setRequestOptions(const QString &url, CPLOptions &options) {
+    QString authHeader = NGRequest::getAuthHeader(url);
+    if(authHeader.isNull()) {
+        options.set(CPLOption::HEADERS, "Accept: */*");
+    }
+    else {
+        options.set(CPLOption::HEADERS, {"Accept: */*\r\n", authHeader});
+    }
+}
 
-    options.AddNameValue("HEADERS", headers.join("\r\n").toStdString().c_str());
-    return options;
+////////////////////////////////////////////////////////////////////////////////
+// Endpoint probe
+////////////////////////////////////////////////////////////////////////////////
+
+constexpr const char *pemBegin = "-----BEGIN PUBLIC KEY-----";
+constexpr const char *pemEnd = "-----END PUBLIC KEY-----";
+// Public key is less than 1 KB, larger body is not the key
+constexpr int probeBodyLimit = 4096;
+
+struct ProbeEntry {
+    QMutex mutex; // Held during probe, guards fields below
+    bool available = false;
+    QByteArray etag;
+    QElapsedTimer checked;
+};
+
+struct ProbeBody {
+    QByteArray data;
+    bool complete;
+};
+
+static QMutex gProbeMutex; // Guards gProbeCache only, not held during I/O
+static QHash<QString, std::shared_ptr<ProbeEntry>> gProbeCache;
+static std::atomic<int> gProbeTTL(10000);
+
+static std::shared_ptr<ProbeEntry> probeEntry(const QString &url)
+{
+    QMutexLocker locker(&gProbeMutex);
+    std::shared_ptr<ProbeEntry> &entry = gProbeCache[url];
+    if(!entry) {
+        entry = std::make_shared<ProbeEntry>();
+    }
+    return entry;
+}
+
+static bool probeWrite(const char *data, size_t size, void *arg)
+{
+    ProbeBody *body = static_cast<ProbeBody*>(arg);
+    body->data.append(data, static_cast<int>(size));
+    if(body->data.contains(pemEnd)) {
+        // Key is received, the rest is not needed
+        body->complete = true;
+        return false;
+    }
+    return body->data.size() <= probeBodyLimit;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// System proxy resolution
+////////////////////////////////////////////////////////////////////////////////
+
+// PAC scripts are evaluated by system, results are kept for 5 minutes or
+// until network configuration changes
+constexpr int proxyCacheTTL = 300000;
+
+struct ProxyEntry {
+    QByteArray proxy; // Empty for direct connection
+    QByteArray userPwd;
+    QElapsedTimer resolved;
+};
+
+static std::atomic<bool> gSystemProxy(false);
+static QMutex gProxyMutex;
+static QHash<QString, ProxyEntry> gProxyCache;
+
+static void clearProxyCache()
+{
+    QMutexLocker locker(&gProxyMutex);
+    gProxyCache.clear();
+}
+
+static void onNetworkChanged()
+{
+    clearProxyCache();
+    NGHostCache::instance().clear();
+}
+
+/**
+ * @brief Drop cached proxies and host names when network changes. Used with
+ * system proxy only: configuration manager polls network interfaces, which
+ * causes latency spikes on Wi-Fi. Other applications call
+ * NGRequest::networkChanged.
+ */
+static void watchNetworkChanges()
+{
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    static std::atomic<bool> watching(false);
+    QCoreApplication *app = QCoreApplication::instance();
+    if(app == nullptr || watching.exchange(true)) {
+        return;
+    }
+    // Created in the main thread, which has event loop for notifications
+    QTimer::singleShot(0, app, [app]() {
+QT_WARNING_PUSH
+QT_WARNING_DISABLE_DEPRECATED
+        QNetworkConfigurationManager *manager =
+                new QNetworkConfigurationManager(app);
+        QObject::connect(manager, &QNetworkConfigurationManager::onlineStateChanged,
+                         onNetworkChanged);
+        QObject::connect(manager, &QNetworkConfigurationManager::configurationChanged,
+                         onNetworkChanged);
+QT_WARNING_POP
+    });
+#endif // QT_VERSION < 6.0.0
+}
+
+/**
+ * @brief System proxy for destination (scheme, host and port). PAC rules may
+ * depend on path too, but such rules are rare and resolving per URL would
+ * make cache useless.
+ */
+static ProxyEntry systemProxy(const QUrl &url)
+{
+    QString key = url.toString(QUrl::RemoveUserInfo | QUrl::RemovePath |
+                               QUrl::RemoveQuery | QUrl::RemoveFragment);
+    {
+        QMutexLocker locker(&gProxyMutex);
+        auto it = gProxyCache.constFind(key);
+        if(it != gProxyCache.constEnd() &&
+                !it.value().resolved.hasExpired(proxyCacheTTL)) {
+            return it.value();
+        }
+    }
+
+    ProxyEntry entry;
+    QList<QNetworkProxy> proxies =
+            QNetworkProxyFactory::systemProxyForQuery(QNetworkProxyQuery(url));
+    // Use first proxy if any
+    if(!proxies.isEmpty() && proxies[0].type() != QNetworkProxy::NoProxy &&
+            proxies[0].type() != QNetworkProxy::DefaultProxy) {
+        const QNetworkProxy &proxy = proxies[0];
+        QString proxyUrl = QString("%1:%2").arg(proxy.hostName()).arg(proxy.port());
+        if(proxy.type() == QNetworkProxy::Socks5Proxy) {
+            proxyUrl.prepend(QLatin1String("socks5h://"));
+        }
+        entry.proxy = proxyUrl.toUtf8();
+        if(!proxy.user().isEmpty()) {
+            entry.userPwd = (proxy.user() + ":" + proxy.password()).toUtf8();
+        }
+    }
+    entry.resolved.start();
+
+    QMutexLocker locker(&gProxyMutex);
+    gProxyCache[key] = entry;
+    return entry;
+}
+
+// String member of JSON object or default value if member is missing or is not
+// a string
+static QString jsonString(const CPLJSONObject &root, const char *key,
+                          const QString &defaultValue)
+{
+    CPLJSONObject value = root.GetObj(key);
+    if(value.GetType() != CPLJSONObject::Type::String) {
+        return defaultValue;
+    }
+    std::string str = value.ToString();
+    return QString::fromUtf8(str.data(), static_cast<int>(str.size()));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -72,10 +258,11 @@ static CPLStringList getOptions(const QString &url) {
 
 static auto gAuthHeaderCallback = [](const char *pszURL) -> std::string
 {
-    if (!pszURL)
+    if (!pszURL || gTokenRefresh)
         return "";
 
-    return NGRequest::instance().authHeader(QString(pszURL)).toStdString();
+    Utf8 header(NGRequest::instance().authHeader(QString::fromUtf8(pszURL)));
+    return std::string(header.data(), static_cast<size_t>(header.size()));
 };
 
 static void InstallAuthHeaderCallback()
@@ -139,10 +326,29 @@ private:
     QString m_updateToken;
     QString m_tokenServer;
     int m_expiresIn;
-    time_t m_lastCheck;
+    time_t m_expiresAt;
     NGRequest *m_request;
+    // Guards token fields, never held during network requests
+    mutable QMutex m_mutex;
+    // Held during token refresh, so concurrent requests wait for one refresh
+    // instead of sending own
+    QMutex m_refreshMutex;
 };
 
+/**
+ * @brief Token expiration time. Uses exp claim if token is JWT, otherwise time
+ * of last token update plus expires_in.
+ */
+static time_t expirationTime(const QString &accessToken, time_t lastCheck,
+                             int expiresIn)
+{
+    qint64 exp = NGJWT::decode(accessToken).exp();
+    if(exp > 0) {
+        return static_cast<time_t>(exp);
+    }
+    return lastCheck + expiresIn;
+}
+
 HTTPAuthBearer::HTTPAuthBearer(const QString &clientId,
                                const QString &tokenServer, const QString &accessToken,
                                const QString &updateToken, int expiresIn,
@@ -152,7 +358,7 @@ HTTPAuthBearer::HTTPAuthBearer(const QString &clientId,
     m_updateToken(updateToken),
     m_tokenServer(tokenServer),
     m_expiresIn(expiresIn),
-    m_lastCheck(lastCheck),
+    m_expiresAt(expirationTime(accessToken, lastCheck, expiresIn)),
     m_request(request)
 {
 
@@ -160,6 +366,7 @@ HTTPAuthBearer::HTTPAuthBearer(const QString &clientId,
 
 const QMap<QString, QString> HTTPAuthBearer::properties() const
 {
+    QMutexLocker locker(&m_mutex);
     QMap<QString, QString> out;
     out["type"] = "bearer";
     out["clientId"] = m_clientId;
@@ -173,31 +380,41 @@ const QMap<QString, QString> HTTPAuthBearer::properties() const
 const QString HTTPAuthBearer::header()
 {
     // 1. Check if expires if not return current access token
-    time_t now = time(nullptr);
-    double seconds = difftime(now, m_lastCheck);
-    seconds += 2; // Two seconds addition to expiration
-    if(seconds < m_expiresIn) {
-        return QString("Authorization: Bearer %1").arg(m_accessToken);
+    // Two seconds addition to expiration
+    {
+        QMutexLocker locker(&m_mutex);
+        if(difftime(m_expiresAt, time(nullptr)) > 2) {
+            return QString("Authorization: Bearer %1").arg(m_accessToken);
+        }
     }
 
-    // 2. Try to update token
-    auto updateToken = m_updateToken.toStdString();
-    const char *payload = CPLSPrintf("grant_type=refresh_token&client_id=%s&refresh_token=%s",
-                                m_clientId.toStdString().c_str(),
-                                updateToken.c_str());
-    CPLStringList options(m_request->baseOptions());
-    options.AddNameValue("CUSTOMREQUEST", "POST");
-    options.AddNameValue("POSTFIELDS", payload);
-
-    RemoveAuthHeaderCallback();
+    // 2. Try to update token. Token may be already updated while waiting for
+    // other refresh.
+    QMutexLocker refreshLocker(&m_refreshMutex);
+    time_t now = time(nullptr);
+    QString updateToken;
+    {
+        QMutexLocker locker(&m_mutex);
+        if(difftime(m_expiresAt, now) > 2) {
+            return QString("Authorization: Bearer %1").arg(m_accessToken);
+        }
+        updateToken = m_updateToken;
+    }
 
-    CPLHTTPResult *result = CPLHTTPFetch(m_tokenServer.toStdString().c_str(), options);
+    CPLOptions options(m_request->sharedBaseOptions());
+    options.set(CPLOption::CUSTOMREQUEST, "POST");
+    options.set(CPLOption::POSTFIELDS, {"grant_type=refresh_token&client_id=",
+                                        m_clientId, "&refresh_token=",
+                                        updateToken});
 
-    InstallAuthHeaderCallback();
+    gTokenRefresh = true;
+    NGHTTPResponse response =
+            m_request->fetch(m_tokenServer, options);
+    gTokenRefresh = false;
 
-    if(result->nStatus != 0 || result->pszErrBuf != nullptr) {
-        if(EQUALN("HTTP error code :", result->pszErrBuf, 17) == FALSE) { // If server error refresh token - logout
-            CPLHTTPDestroyResult( result );
+    QMutexLocker locker(&m_mutex);
+    if(!response.isOk()) {
+        if(!response.errorMessage.startsWith("HTTP error code :")) { // If server error refresh token - logout
             qDebug() << "Failed to refresh token. Return last not expired. ";
             return QString("Authorization: Bearer %1").arg(m_accessToken);
         }
@@ -205,28 +422,25 @@ const QString HTTPAuthBearer::header()
 
     m_accessToken.clear();
     CPLJSONDocument resultJson;
-    if(!resultJson.LoadMemory(result->pabyData, result->nDataLen)) {
-        CPLHTTPDestroyResult( result );
+    if(!resultJson.LoadMemory(reinterpret_cast<const GByte*>(response.data()),
+                              static_cast<int>(response.size()))) {
         qDebug() << "Token is expired. ";
         return "expired";
     }
-    CPLHTTPDestroyResult( result );
 
     // 4. Save new update and access tokens
     CPLJSONObject root = resultJson.GetRoot();
     auto err = root.GetString("error", "");
     if(!err.empty()) {
         qDebug() << "Token is expired. " <<
-                    "\nError:" << QString::fromStdString(err);
+                    "\nError:" << QString::fromUtf8(err.c_str());
         return "expired";
     }
 
-    m_accessToken = QString::fromStdString(
-                root.GetString("access_token", m_accessToken.toStdString()));
-    m_updateToken = QString::fromStdString(
-                root.GetString("refresh_token", updateToken));
+    m_accessToken = jsonString(root, "access_token", QString());
+    m_updateToken = jsonString(root, "refresh_token", m_updateToken);
     m_expiresIn = root.GetInteger("expires_in", m_expiresIn);
-    m_lastCheck = now;
+    m_expiresAt = expirationTime(m_accessToken, now, m_expiresIn);
 
     // 5. Return new Auth Header
     qDebug() << "Token updated.";
@@ -239,11 +453,12 @@ const QString HTTPAuthBearer::header()
 ////////////////////////////////////////////////////////////////////////////////
 
 NGRequest::NGRequest() :
+    m_transport(new NGCurlTransport),
     m_connTimeout("15"),
     m_timeout("20"),
     m_maxRetry("3"),
     m_retryDelay("5"),
-    m_detailedError("")
+    m_baseOptions(nullptr)
 {
     InstallAuthHeaderCallback();
 
@@ -253,51 +468,241 @@ NGRequest::NGRequest() :
     QDir certPemDir(certPemPath);
     m_certPem = certPemDir.absoluteFilePath("cert.pem");
 #endif
+
+    m_baseOptions = CSLSetNameValue(m_baseOptions, CPLOption::CONNECTTIMEOUT,
+                                    Utf8(m_connTimeout));
+    m_baseOptions = CSLSetNameValue(m_baseOptions, CPLOption::TIMEOUT,
+                                    Utf8(m_timeout));
+    m_baseOptions = CSLSetNameValue(m_baseOptions, CPLOption::MAX_RETRY,
+                                    Utf8(m_maxRetry));
+    m_baseOptions = CSLSetNameValue(m_baseOptions, CPLOption::RETRY_DELAY,
+                                    Utf8(m_retryDelay));
+#ifdef Q_OS_WIN
+    m_baseOptions = CSLSetNameValue(m_baseOptions, CPLOption::CAINFO,
+                                    Utf8(m_certPem));
+#endif
 }
 
 NGRequest::~NGRequest()
 {
     RemoveAuthHeaderCallback();
+    CSLDestroy(m_baseOptions);
 }
 
 void NGRequest::setErrorMessage(const QString &err)
 {
-    m_detailedError = err;
+    gLastError = err;
 }
 
 char **NGRequest::baseOptions() const
 {
-    char **options = nullptr;
-    auto connTimeout = m_connTimeout.toStdString();
-    options = CSLAddNameValue(options, "CONNECTTIMEOUT", connTimeout.c_str());
-    auto timeout = m_timeout.toStdString();
-    options = CSLAddNameValue(options, "TIMEOUT", timeout.c_str());
-    auto maxRetry = m_maxRetry.toStdString();
-    options = CSLAddNameValue(options, "MAX_RETRY", maxRetry.c_str());
-    auto retryDelay = m_retryDelay.toStdString();
-    options = CSLAddNameValue(options, "RETRY_DELAY", retryDelay.c_str());
+    return CSLDuplicate(m_baseOptions);
+}
 
-#ifdef Q_OS_WIN
-    auto certPem = m_certPem.toStdString();
-    options = CSLAddNameValue(options, "CAINFO", certPem.c_str());
-#endif
+/**
+ * @brief Base options list built once on construction. The list is owned by
+ * NGRequest and must not be modified or freed.
+ * @return CPL string list.
+ */
+const char * const *NGRequest::sharedBaseOptions() const
+{
+    return m_baseOptions;
+}
+
+/**
+ * @brief Set transport used by all requests. For example, NGLoopbackTransport
+ * to run without network.
+ * @param transport New transport or null to restore default curl transport.
+ */
+void NGRequest::setTransport(QSharedPointer<IHTTPTransport> transport)
+{
+    NGRequest &request = instance();
+    QMutexLocker locker(&request.m_transportMutex);
+    if(transport.isNull()) {
+        request.m_transport = QSharedPointer<IHTTPTransport>(new NGCurlTransport);
+    }
+    else {
+        request.m_transport = transport;
+    }
+}
 
-    return options;
+QSharedPointer<IHTTPTransport> NGRequest::transport() const
+{
+    QMutexLocker locker(&m_transportMutex);
+    return m_transport;
 }
 
+struct MetricsWriteContext {
+    NGHTTPWriteFunc write;
+    void *arg;
+    qint64 bytes;
+};
+
+static bool metricsWrite(const char *data, size_t size, void *arg)
+{
+    MetricsWriteContext *context = static_cast<MetricsWriteContext*>(arg);
+    context->bytes += static_cast<qint64>(size);
+    return context->write(data, size, context->arg);
+}
+
+static qint64 requestSize(char **options)
+{
+    qint64 size = 0;
+    const char *postFields = CSLFetchNameValue(options, CPLOption::POSTFIELDS);
+    if(postFields != nullptr) {
+        size += static_cast<qint64>(strlen(postFields));
+    }
+    const char *formFile = CSLFetchNameValue(options, CPLOption::FORM_FILE_PATH);
+    if(formFile != nullptr) {
+        size += QFileInfo(QString::fromUtf8(formFile)).size();
+    }
+    return size;
+}
+
+// libcurl CURLE_COULDNT_RESOLVE_HOST
+constexpr int couldNotResolveHost = 6;
+
+/**
+ * @brief Execute request with current transport. Request is added to
+ * NGRequestMetrics if metrics are enabled, response without body is stored as
+ * the calling thread last result (see lastResult). Requests to hosts which
+ * recently failed to resolve fail immediately (see NGHostCache). If system
+ * proxy is used, proxy for the destination is set unless options have one.
+ * @param url URL to fetch.
+ * @param options CPLHTTPFetch options.
+ * @param write Optional body callback (see IHTTPTransport::fetch).
+ * @param writeArg Callback argument.
+ * @return Response.
+ */
+NGHTTPResponse NGRequest::fetch(const QString &url, char **options,
+                                NGHTTPWriteFunc write, void *writeArg) const
+{
+    QUrl parsedUrl(url);
+    QString host = parsedUrl.host();
+    NGHTTPResponse response;
+    if(NGHostCache::instance().isUnresolvable(host)) {
+        response.error = couldNotResolveHost;
+        response.errorMessage = QString("Could not resolve host: %1").arg(host);
+        gLastResult = response;
+        return response;
+    }
+
+    CPLOptions proxyOptions(options);
+    if(gSystemProxy && CSLFetchNameValue(options, CPLOption::PROXY) == nullptr) {
+        ProxyEntry proxy = systemProxy(parsedUrl);
+        // Empty value disables proxy set by GDAL_HTTP_PROXY
+        proxyOptions.set(CPLOption::PROXY, proxy.proxy.constData());
+        if(!proxy.userPwd.isEmpty()) {
+            proxyOptions.set(CPLOption::PROXYUSERPWD, proxy.userPwd.constData());
+            proxyOptions.set(CPLOption::PROXYAUTH, "ANY");
+        }
+        options = proxyOptions;
+    }
+
+    Utf8 urlUtf8(url);
+    QSharedPointer<IHTTPTransport> currentTransport = transport();
+    if(!NGRequestMetrics::isEnabled()) {
+        response = currentTransport->fetch(urlUtf8, options, write, writeArg);
+    }
+    else {
+        QElapsedTimer timer;
+        timer.start();
+        MetricsWriteContext context = { write, writeArg, 0 };
+        response = write ?
+                    currentTransport->fetch(urlUtf8, options, metricsWrite, &context) :
+                    currentTransport->fetch(urlUtf8, options);
+        if(response.timings.total < 0) {
+            response.timings.total = timer.nsecsElapsed() / 1000;
+        }
+        NGRequestMetrics::instance().record(
+                    urlUtf8, response,
+                    write ? context.bytes : static_cast<qint64>(response.size()),
+                    requestSize(options));
+    }
+
+    if(response.error == couldNotResolveHost) {
+        NGHostCache::instance().setUnresolvable(host);
+    }
+
+    gLastResult = response;
+    gLastResult.setBody(QByteArray());
+    return response;
+}
+
+/**
+ * @brief Result of the last request executed by the calling thread: HTTP
+ * status, transport error, retries and timings. Body is not kept.
+ * @return Response without body.
+ */
+NGHTTPResponse NGRequest::lastResult()
+{
+    return gLastResult;
+}
+
+/**
+ * @brief Record all requests to the traffic log. Use startReplay to serve
+ * recorded responses later.
+ * @param path Log file path.
+ * @return true if log file was created.
+ */
+bool NGRequest::startRecording(const QString &path)
+{
+    NGRequest &request = instance();
+    QMutexLocker locker(&request.m_transportMutex);
+    QSharedPointer<NGRecordingTransport> recorder(
+                new NGRecordingTransport(request.m_transport, path));
+    if(!recorder->isOpen()) {
+        return false;
+    }
+    request.m_transport = recorder;
+    return true;
+}
+
+void NGRequest::stopRecording()
+{
+    NGRequest &request = instance();
+    QMutexLocker locker(&request.m_transportMutex);
+    auto recorder = qSharedPointerDynamicCast<NGRecordingTransport>(
+                request.m_transport);
+    if(recorder) {
+        request.m_transport = recorder->transport();
+    }
+}
+
+/**
+ * @brief Serve responses from the traffic log instead of network.
+ * @param path Log file path.
+ * @param pace Replay speed: 0 - no delays, 1 - recorded durations, 2 - twice
+ * as fast, etc.
+ * @return true if log was loaded. Call setTransport(nullptr) to stop replay.
+ */
+bool NGRequest::startReplay(const QString &path, double pace)
+{
+    QSharedPointer<NGReplayTransport> replay(new NGReplayTransport(path, pace));
+    if(!replay->isValid()) {
+        return false;
+    }
+    setTransport(replay);
+    return true;
+}
+
+/**
+ * @brief Last error set in the calling thread.
+ * @return Error description or empty string.
+ */
 QString NGRequest::lastError() const
 {
-    return m_detailedError;
+    return gLastError;
 }
 
 void NGRequest::resetError()
 {
-    m_detailedError.clear();
+    gLastError.clear();
+    gLastResult = NGHTTPResponse();
 }
 
 bool NGRequest::addAuth(const QStringList &urls, const QMap<QString, QString> &options)
 {
-    MUTEX_LOCKER;
 
     if(options["type"] == "bearer") {
         int expiresIn = options["expiresIn"].toInt();
@@ -316,14 +721,16 @@ bool NGRequest::addAuth(const QStringList &urls, const QMap<QString, QString> &o
             if(!verify.isEmpty()) {
                 postPayload += "&code_verifier=" + verify;
             }
-            CPLStringList options(instance().baseOptions());
-            auto payload = postPayload.toStdString();
-            options.AddNameValue("CUSTOMREQUEST", "POST");
-            options.AddNameValue("POSTFIELDS", payload.c_str());
+            CPLOptions options(instance().sharedBaseOptions());
+            options.set(CPLOption::CUSTOMREQUEST, "POST");
+            options.set(CPLOption::POSTFIELDS, postPayload);
 
             time_t now = time(nullptr);
-            auto tokenServerStd = tokenServer.toStdString();
-            bool result = fetchToken.LoadUrl(tokenServerStd.c_str(), options);
+            NGHTTPResponse response =
+                    instance().fetch(tokenServer, options);
+            bool result = response.isOk() && fetchToken.LoadMemory(
+                        reinterpret_cast<const GByte*>(response.data()),
+                        static_cast<int>(response.size()));
             qDebug() << "Server: " << tokenServer << "\noptions:" << postPayload;
             if(!result) {
                 qDebug() << "Failed to get tokens";
@@ -331,12 +738,8 @@ bool NGRequest::addAuth(const QStringList &urls, const QMap<QString, QString> &o
             }
 
             CPLJSONObject root = fetchToken.GetRoot();
-            auto accessTokenStd = accessToken.toStdString();
-            accessToken = QString::fromStdString(
-                        root.GetString("access_token", accessTokenStd));
-            auto updateTokenStr = updateToken.toStdString();
-            updateToken = QString::fromStdString(
-                        root.GetString("refresh_token", updateTokenStr.c_str()));
+            accessToken = jsonString(root, "access_token", accessToken);
+            updateToken = jsonString(root, "refresh_token", updateToken);
             expiresIn = root.GetInteger("expires_in", expiresIn);
             lastCheck = now;
         }
@@ -377,65 +780,143 @@ void NGRequest::removeAuthURL(const QString &url)
 
 QString NGRequest::getAsString(const QString &url)
 {
-    MUTEX_LOCKER;
-
-    CPLStringList options = getOptions(url);
-    CPLHTTPResult *result = CPLHTTPFetch(url.toStdString().c_str(), options);
-    if(result->nStatus != 0 || result->pszErrBuf != nullptr) {
-        CPLHTTPDestroyResult( result );
+    CPLOptions options(instance().sharedBaseOptions());
+    setRequestOptions(url, options);
+    NGHTTPResponse response = instance().fetch(url, options);
+    if(!response.isOk()) {
         return QString();
     }
-    QByteArray data(reinterpret_cast<const char*>(result->pabyData), result->nDataLen);
-    CPLHTTPDestroyResult(result);
-    return data;
+    return QString::fromUtf8(response.data(), static_cast<int>(response.size()));
 }
 
 QString NGRequest::getJsonAsString(const QString &url)
 {
-    MUTEX_LOCKER;
+    CPLOptions options(instance().sharedBaseOptions());
+    setRequestOptions(url, options);
+    NGHTTPResponse response = instance().fetch(url, options);
+    if(!response.isOk()) {
+        return QString();
+    }
 
-    CPLStringList options = getOptions(url);
-    QString out;
-    CPLJSONDocument in;
-    if(in.LoadUrl(url.toStdString(), options)) {
-        out = QString::fromUtf8(in.SaveAsString().c_str());
+    // Validate without building document, return body as is
+    NGJsonHandler validator;
+    NGJsonStreamReader reader(&validator);
+    if(reader.feed(response.data(), response.size()) && reader.finish()) {
+        return QString::fromUtf8(response.data(),
+                                 static_cast<int>(response.size()));
     }
-    return out;
+    return QString();
 }
 
 QMap<QString, QVariant> NGRequest::getJsonAsMap(const QString &url)
 {
-    MUTEX_LOCKER;
+    CPLOptions options(instance().sharedBaseOptions());
+    setRequestOptions(url, options);
+    NGHTTPResponse response = instance().fetch(url, options);
+    if(!response.isOk()) {
+        return QMap<QString, QVariant>();
+    }
+    return bufferToMap(response.data(), response.size());
+}
 
-    CPLStringList options = getOptions(url);
-    CPLJSONDocument in;
-    if(in.LoadUrl(url.toStdString(), options)) {
-        qDebug() << QString::fromStdString(in.GetRoot().Format(CPLJSONObject::PrettyFormat::Pretty));
-        return toMap(in.GetRoot());
+/**
+ * @brief Fetch json document and convert only requested values.
+ * @param url URL to fetch json from.
+ * @param keys List of paths to extract (see toMap).
+ * @return map of key - value pairs. Missing keys are not present in map.
+ */
+QMap<QString, QVariant> NGRequest::getJsonAsMap(const QString &url,
+                                                const QStringList &keys)
+{
+    CPLOptions options(instance().sharedBaseOptions());
+    setRequestOptions(url, options);
+    NGHTTPResponse response = instance().fetch(url, options);
+    if(!response.isOk()) {
+        return QMap<QString, QVariant>();
     }
+    return bufferToMap(response.data(), response.size(), keys);
+}
+
+// HTTP status is known only when transfer ends. Error bodies (401, 404 json)
+// are small, so body is held until it grows over this size or transfer ends
+// and handler never receives error body.
+constexpr int jsonStreamHoldSize = 65536;
 
-    return QMap<QString, QVariant>();
+struct JsonStreamContext {
+    NGJsonStreamReader *reader;
+    QByteArray held;
+    bool streaming;
+};
+
+static bool jsonStreamWrite(const char *data, size_t size, void *arg)
+{
+    JsonStreamContext *context = static_cast<JsonStreamContext*>(arg);
+    if(context->streaming) {
+        return context->reader->feed(data, size);
+    }
+    context->held.append(data, static_cast<int>(size));
+    if(context->held.size() < jsonStreamHoldSize) {
+        return true;
+    }
+    context->streaming = true;
+    bool result = context->reader->feed(context->held.constData(),
+                                        static_cast<size_t>(context->held.size()));
+    context->held.clear();
+    return result;
 }
 
-bool NGRequest::getFile(const QString &url, const QString &path)
+/**
+ * @brief Fetch json document and pass parse events to handler while data is
+ * downloading. The document is never fully loaded into memory. The first
+ * 64 KB are held until transfer ends or grows over it, so bodies of HTTP
+ * errors are not passed to handler. Handler callbacks are executed in the
+ * calling thread. Retries are disabled as
+ * handler may not receive the same events twice.
+ * @param url URL to fetch json from.
+ * @param handler Parse events handler.
+ * @return true if document was downloaded and parsed successfully.
+ */
+bool NGRequest::getJsonStream(const QString &url, NGJsonHandler *handler)
 {
-    MUTEX_LOCKER;
+    CPLOptions options(instance().sharedBaseOptions());
+    setRequestOptions(url, options);
+    options.set(CPLOption::MAX_RETRY, "0");
+
+    NGJsonStreamReader reader(handler);
+    JsonStreamContext context = { &reader, QByteArray(), false };
+    NGHTTPResponse response = instance().fetch(url, options, jsonStreamWrite,
+                                               &context);
+    if(!response.isOk()) {
+        return false;
+    }
+    if(!context.streaming && !context.held.isEmpty() &&
+            !reader.feed(context.held.constData(),
+                         static_cast<size_t>(context.held.size()))) {
+        qDebug() << "Failed to parse json stream:" << reader.errorMessage();
+        return false;
+    }
+
+    bool out = reader.finish();
+    if(!out && reader.hasError()) {
+        qDebug() << "Failed to parse json stream:" << reader.errorMessage();
+    }
+    return out;
+}
 
-    CPLStringList options = getOptions(url);
-    CPLHTTPResult *result = CPLHTTPFetch(url.toStdString().c_str(), options);
-    if(result->nStatus != 0 || result->pszErrBuf != nullptr) {
-        CPLHTTPDestroyResult( result );
+bool NGRequest::getFile(const QString &url, const QString &path)
+{
+    CPLOptions options(instance().sharedBaseOptions());
+    setRequestOptions(url, options);
+    NGHTTPResponse response = instance().fetch(url, options);
+    if(!response.isOk()) {
         return false;
     }
 
-    QByteArray data(reinterpret_cast<const char*>(result->pabyData), result->nDataLen);
     QFile file(path);
     file.open(QIODevice::WriteOnly);
-    file.write(data);
+    file.write(response.data(), static_cast<qint64>(response.size()));
     file.close();
 
-    CPLHTTPDestroyResult(result);
-
     return true;
 }
 
@@ -447,36 +928,33 @@ NGRequest &NGRequest::instance()
 
 void NGRequest::addAuth(const QString &url, QSharedPointer<IHTTPAuth> auth)
 {
+    MUTEX_LOCKER;
     m_auths[url] = auth;
 }
 
 void NGRequest::removeAuth(const QString &url, const QString &logoutUrl)
 {
-    MUTEX_LOCKER;
-
     if(!logoutUrl.isEmpty()) {
         auto prop = properties(url);
         if(!prop.empty()) {
-            auto updateToken = prop["updateToken"].toStdString();
-            auto clientId = prop["clientId"].toStdString();
-            const char *payload = CPLSPrintf("client_id=%s&refresh_token=%s",
-                                    clientId.c_str(),
-                                    updateToken.c_str());
-            CPLStringList options(baseOptions());
-            options.AddNameValue("CUSTOMREQUEST", "POST");
-            options.AddNameValue("POSTFIELDS", payload);
-            options.AddNameValue("HEADERS", "Content-Type: application/x-www-form-urlencoded");
-
-            CPLHTTPResult *result = CPLHTTPFetch(logoutUrl.toStdString().c_str(), options);
-
-            if(result->nStatus != 0 || result->pszErrBuf != nullptr) {
-                if(EQUALN("HTTP error code :", result->pszErrBuf, 17) == FALSE) { // If server error refresh token - logout
+            CPLOptions options(sharedBaseOptions());
+            options.set(CPLOption::CUSTOMREQUEST, "POST");
+            options.set(CPLOption::POSTFIELDS, {"client_id=", prop["clientId"],
+                                                "&refresh_token=",
+                                                prop["updateToken"]});
+            options.set(CPLOption::HEADERS, "Content-Type: application/x-www-form-urlencoded");
+
+            NGHTTPResponse response = fetch(logoutUrl, options);
+
+            if(!response.isOk()) {
+                if(!response.errorMessage.startsWith("HTTP error code :")) { // If server error refresh token - logout
                     qDebug() << "Failed to logout.";
                 }
             }
-            CPLHTTPDestroyResult( result );
         }
     }
+
+    MUTEX_LOCKER;
     m_auths.remove(url);
 }
 
@@ -499,12 +977,18 @@ void NGRequest::removeAuthURLImpl(const QString &url)
 }
 
 const QString NGRequest::authHeader(const QString &url)
+{
+    // Token may be refreshed in header(), so it is called without lock
+    QSharedPointer<IHTTPAuth> auth = findAuth(url);
+    return auth ? auth->header() : QString();
+}
+
+QSharedPointer<IHTTPAuth> NGRequest::findAuth(const QString &url) const
 {
     MUTEX_LOCKER;
 
     if(!m_auths.empty() && url == "any") {
-        auto it = m_auths.constBegin();
-        return it.value()->header();
+        return m_auths.constBegin().value();
     }
 
     auto removeScheme = [](const QString &url) -> QString
@@ -512,13 +996,13 @@ const QString NGRequest::authHeader(const QString &url)
         return QUrl(url).toString(QUrl::RemoveScheme);
     };
 
-    QMap<QString, QSharedPointer<IHTTPAuth>>::iterator it;
-    for(it = m_auths.begin(); it != m_auths.end(); ++it) {
-        if(removeScheme(url).startsWith(removeScheme(it.key()))) {
-            return it.value()->header();
+    QString path = removeScheme(url);
+    for(auto it = m_auths.constBegin(); it != m_auths.constEnd(); ++it) {
+        if(path.startsWith(removeScheme(it.key()))) {
+            return it.value();
         }
     }
-    return QString();
+    return QSharedPointer<IHTTPAuth>();
 }
 
 /**
@@ -528,11 +1012,12 @@ const QString NGRequest::authHeader(const QString &url)
  */
 const QMap<QString, QString> NGRequest::properties(const QString &url) const
 {
-    QMap<QString, QString> out;
-    if(m_auths.contains(url)) {
-        return m_auths[url]->properties();
+    QSharedPointer<IHTTPAuth> auth;
+    {
+        MUTEX_LOCKER;
+        auth = m_auths.value(url);
     }
-    return out;
+    return auth ? auth->properties() : QMap<QString, QString>();
 }
 
 QString NGRequest::getAuthHeader(const QString &url)
@@ -550,8 +1035,6 @@ QString NGRequest::getAuthHeader(const QString &url)
 QString NGRequest::uploadFile(const QString &url, const QString &path,
                               const QString &name)
 {
-    MUTEX_LOCKER;
-
     CPLErrorReset();
     instance().resetError();
     
@@ -562,62 +1045,97 @@ QString NGRequest::uploadFile(const QString &url, const QString &path,
                         GDALVersionInfo("VERSION_NUM")));
         return "";
     }
-    CPLStringList options = getOptions(url);
-    options.AddNameValue("FORM_FILE_PATH", path.toStdString().c_str());
-    options.AddNameValue("FORM_FILE_NAME", name.toStdString().c_str());
-    CPLHTTPResult *result = CPLHTTPFetch(url.toStdString().c_str(), options);
-    if(result->nStatus != 0 || result->pszErrBuf != nullptr) {
+    CPLOptions options(instance().sharedBaseOptions());
+    setRequestOptions(url, options);
+    options.set(CPLOption::FORM_FILE_PATH, path);
+    options.set(CPLOption::FORM_FILE_NAME, name);
+    NGHTTPResponse response = instance().fetch(url, options);
+    if(!response.isOk()) {
         instance().setErrorMessage(
                     QString("CPLHTTPFetch() failed. Info: \nnStatus = %1 \npszErrBuf = %2 \nGDAL error = %3")
-            .arg(result->nStatus).arg(result->pszErrBuf == nullptr ? "" : result->pszErrBuf).arg(CPLGetLastErrorMsg()));
-        CPLHTTPDestroyResult( result );
+            .arg(response.error).arg(response.errorMessage).arg(CPLGetLastErrorMsg()));
         return "";
     }
 
-    QByteArray data(reinterpret_cast<const char*>(result->pabyData), result->nDataLen);
-    CPLHTTPDestroyResult(result);
+    return QString::fromUtf8(response.data(), static_cast<int>(response.size()));
+}
 
-    return data;
+/**
+ * @brief Send data to the server.
+ * @param url URL to send data to.
+ * @param body Request body. Must not contain zero bytes as CPLHTTPFetch takes
+ * it as C string.
+ * @param contentType Body content type.
+ * @param method HTTP method: POST, PUT, PATCH, DELETE, etc.
+ * @return Response.
+ */
+NGHTTPResponse NGRequest::post(const QString &url, const QByteArray &body,
+                               const QString &contentType,
+                               const QString &method)
+{
+    CPLOptions options(instance().sharedBaseOptions());
+    QString authHeader = getAuthHeader(url);
+    if(authHeader.isNull()) {
+        options.set(CPLOption::HEADERS, {"Accept: */*\r\nContent-Type: ",
+                                         contentType});
+    }
+    else {
+        options.set(CPLOption::HEADERS, {"Accept: */*\r\nContent-Type: ",
+                                         contentType, "\r\n", authHeader});
+    }
+    options.set(CPLOption::CUSTOMREQUEST, method);
+    if(!body.isEmpty()) {
+        options.set(CPLOption::POSTFIELDS, body.constData());
+    }
+    return instance().fetch(url, options);
 }
 
 /**
  * @brief NGRequest::setProxy Set proxy for all requests.
  * @param useProxy Use or not proxy.
- * @param useSystemProxy Get proxy information from system. Any other properties ignored.
+ * @param useSystemProxy Get proxy information from system. Any other properties
+ * ignored. NGRequest resolves proxy (including PAC rules) for each destination,
+ * GDAL gets proxy of generic http destination.
  * @param proxyUrl Proxy url.
  * @param porxyPort Proxy port.
  * @param proxyUser User to authenticate in proxy.
  * @param proxyPassword Password to authenticate in proxy.
  * @param proxyAuth Proxy authentication scheme to use. Can be BASIC/NTLM/DIGEST/ANY.
  */
+/**
+ * @brief Drop cached proxies and failed host names. Call when network
+ * configuration changes (i.e. from QNetworkInformation notifications).
+ */
+void NGRequest::networkChanged()
+{
+    onNetworkChanged();
+}
+
 void NGRequest::setProxy(bool useProxy, bool useSystemProxy, const QString &proxyUrl,
                          int porxyPort, const QString &proxyUser,
                          const QString &proxyPassword, const QString &proxyAuth)
 {
+    gSystemProxy = useProxy && useSystemProxy;
+    clearProxyCache();
+    if(gSystemProxy) {
+        watchNetworkChanges();
+    }
+
     if(useProxy) {
-        std::string url;
-        std::string userpwd;
+        QString url;
+        QString userpwd;
         if(useSystemProxy) {
-            QNetworkProxyQuery npq(QUrl("http://www.google.com"));
-            QList<QNetworkProxy> listOfProxies =
-                    QNetworkProxyFactory::systemProxyForQuery(npq);
-            // Get first proxy if any.
-            if(!listOfProxies.isEmpty()) {
-                url = listOfProxies[0].hostName().toStdString() + ":" +
-                        std::to_string(listOfProxies[0].port());
-                userpwd = listOfProxies[0].user().toStdString() + ":" +
-                        listOfProxies[0].password().toStdString();
-
-            }
+            ProxyEntry proxy = systemProxy(QUrl("http://www.google.com"));
+            url = proxy.proxy;
+            userpwd = proxy.userPwd;
         }
         else {
-            url = proxyUrl.toStdString() + ":" + std::to_string(porxyPort);
-            userpwd = proxyUser.toStdString() + ":" +
-                    proxyPassword.toStdString();
-            CPLSetConfigOption("GDAL_PROXY_AUTH", proxyAuth.toStdString().c_str());
+            url = proxyUrl + ":" + QString::number(porxyPort);
+            userpwd = proxyUser + ":" + proxyPassword;
+            CPLSetConfigOption("GDAL_PROXY_AUTH", Utf8(proxyAuth));
         }
-        CPLSetConfigOption("GDAL_HTTP_PROXY", url.c_str());
-        CPLSetConfigOption("GDAL_HTTP_PROXYUSERPWD", userpwd.c_str());
+        CPLSetConfigOption("GDAL_HTTP_PROXY", Utf8(url));
+        CPLSetConfigOption("GDAL_HTTP_PROXYUSERPWD", Utf8(userpwd));
     }
     else {
         CPLSetConfigOption("GDAL_HTTP_PROXY", nullptr);
@@ -626,34 +1144,126 @@ void NGRequest::setProxy(bool useProxy, bool useSystemProxy, const QString &prox
     }
 }
 
+/**
+ * @brief Check that endpoint is available and serves the public key. Probe
+ * reuses idle connection of the origin from transport pool, sends ETag of the
+ * last successful check as If-None-Match and stops reading as soon as the key
+ * is received. Result is cached for the time set by setCheckURLTTL.
+ * @param url URL to check (/api/v1/rsa_public_key/ endpoint).
+ * @return true if endpoint is available.
+ */
 bool NGRequest::checkURL(const QString &url)
 {
-//    MUTEX_LOCKER;
-
-    CPLStringList options(NGRequest::instance().baseOptions());
-
-    options.SetNameValue("CUSTOMREQUEST", "GET");
-    options.SetNameValue("NO_BODY", "false");
-    options.SetNameValue("HEADERS", "Accept: */*");
+    // Concurrent checks of the same URL wait for the first one result,
+    // checks of other URLs are not blocked
+    std::shared_ptr<ProbeEntry> probe = probeEntry(url);
+    QMutexLocker locker(&probe->mutex);
+    ProbeEntry &entry = *probe;
+    int ttl = gProbeTTL;
+    if(ttl > 0 && entry.checked.isValid() && !entry.checked.hasExpired(ttl)) {
+        return entry.available;
+    }
 
-    options.SetNameValue("CONNECTTIMEOUT", "5");
-    options.SetNameValue("TIMEOUT", "10");
-    options.SetNameValue("MAX_RETRY", "0");
-    options.SetNameValue("RETRY_DELAY", "0");
+    CPLOptions options(instance().sharedBaseOptions());
 
-    CPLHTTPResult *result = CPLHTTPFetch(url.toStdString().c_str(), options);
-    auto isSuccess = result->nStatus == 0 && result->pszErrBuf == nullptr;
+    options.set(CPLOption::CUSTOMREQUEST, "GET");
+    options.set(CPLOption::NO_BODY, "false");
+    if(entry.etag.isEmpty()) {
+        options.set(CPLOption::HEADERS, "Accept: */*");
+    }
+    else {
+        options.set(CPLOption::HEADERS, {"Accept: */*\r\nIf-None-Match: ",
+                                         entry.etag.constData()});
+    }
 
-    //check result body for conformity /api/v1/rsa_public_key/ endpoint
-    if (isSuccess) {
-      std::string responseBody(result->pabyData, result->pabyData + result->nDataLen);
+    options.set(CPLOption::CONNECTTIMEOUT, "5");
+    options.set(CPLOption::TIMEOUT, "10");
+    options.set(CPLOption::MAX_RETRY, "0");
+    options.set(CPLOption::RETRY_DELAY, "0");
 
-      bool isContainRsaPublicKey = responseBody.find("-----BEGIN PUBLIC KEY-----") != std::string::npos &&
-             responseBody.find("-----END PUBLIC KEY-----") != std::string::npos;
+    ProbeBody body = { QByteArray(), false };
+    NGHTTPResponse response = instance().fetch(url, options, probeWrite, &body);
 
-      isSuccess &= isContainRsaPublicKey;
+    bool isSuccess;
+    if(body.complete) {
+        // Transfer is aborted by probeWrite, check result body for conformity
+        // /api/v1/rsa_public_key/ endpoint
+        isSuccess = body.data.contains(pemBegin);
+    }
+    else {
+        // Key is not changed since the last successful check. CPLHTTPFetch
+        // reports status of errors only, so for curl transport 304 is an empty
+        // answer with the same ETag. Empty 200 from captive portal or proxy is
+        // not success.
+        bool notModified = response.status == 304 ||
+                (response.status == 0 && response.isOk() &&
+                 body.data.isEmpty() && response.header("ETag") == entry.etag);
+        isSuccess = notModified && !entry.etag.isEmpty();
     }
 
-    CPLHTTPDestroyResult(result);
+    QByteArray etag = response.header("ETag");
+    if(!isSuccess) {
+        entry.etag.clear();
+    }
+    else if(!etag.isEmpty()) {
+        entry.etag = etag;
+    }
+    entry.available = isSuccess;
+    entry.checked.start();
     return isSuccess;
 }
+
+QFuture<QMap<QString, QVariant>> NGRequest::getJsonAsMapAsync(const QString &url)
+{
+    return NGIOExecutor::instance().run([url]() { return getJsonAsMap(url); });
+}
+
+QFuture<QString> NGRequest::getJsonAsStringAsync(const QString &url)
+{
+    return NGIOExecutor::instance().run([url]() { return getJsonAsString(url); });
+}
+
+QFuture<QString> NGRequest::getAsStringAsync(const QString &url)
+{
+    return NGIOExecutor::instance().run([url]() { return getAsString(url); });
+}
+
+QFuture<bool> NGRequest::getFileAsync(const QString &url, const QString &path)
+{
+    return NGIOExecutor::instance().run([url, path]() {
+        return getFile(url, path);
+    });
+}
+
+QFuture<QString> NGRequest::uploadFileAsync(const QString &url,
+                                            const QString &path,
+                                            const QString &name)
+{
+    return NGIOExecutor::instance().run([url, path, name]() {
+        return uploadFile(url, path, name);
+    });
+}
+
+QFuture<NGHTTPResponse> NGRequest::postAsync(const QString &url,
+                                             const QByteArray &body,
+                                             const QString &contentType,
+                                             const QString &method)
+{
+    return NGIOExecutor::instance().run([url, body, contentType, method]() {
+        return post(url, body, contentType, method);
+    });
+}
+
+QFuture<bool> NGRequest::checkURLAsync(const QString &url)
+{
+    return NGIOExecutor::instance().run([url]() { return checkURL(url); });
+}
+
+/**
+ * @brief Set how long checkURL result is cached.
+ * @param msec Time in milliseconds, 0 disables cache.
+ */
+void NGRequest::setCheckURLTTL(int msec)
+{
+    gProbeTTL = msec;
+}
@@ -21,15 +21,21 @@
 #define NGCORE_REQUEST_H
 
 #include "core/core.h"
+#include "core/transport.h"
 
+#include <QFuture>
 #include <QMap>
 #include <QMutex>
 #include <QSharedPointer>
 #include <QStringList>
 #include <QVariant>
 
+class NGJsonHandler;
+
 /**
- * @brief The IHTTPAuth class is base class for HTTP Authorization headers
+ * @brief The IHTTPAuth class is base class for HTTP Authorization headers.
+ * Methods are called from any thread without NGRequest lock and must be thread
+ * safe.
  */
 class IHTTPAuth {
 public:
@@ -46,18 +52,44 @@ public:
     static bool addAuthURL(const QString &basicUrl, const QString &newUrl);
     static void removeAuthURL(const QString &url);
     static QMap<QString, QVariant> getJsonAsMap(const QString &url);
+    static QMap<QString, QVariant> getJsonAsMap(const QString &url,
+                                                const QStringList &keys);
     static QString getJsonAsString(const QString &url);
+    static bool getJsonStream(const QString &url, NGJsonHandler *handler);
     static QString getAsString(const QString &url);
     static bool getFile(const QString &url, const QString &path);
     static QString getAuthHeader(const QString &url);
     static QString uploadFile(const QString &url, const QString &path,
                               const QString &name);
+    static NGHTTPResponse post(const QString &url, const QByteArray &body,
+                               const QString &contentType = "application/json",
+                               const QString &method = "POST");
     static void setProxy(bool useProxy = true, bool useSystemProxy = true,
                          const QString &proxyUrl = "",
                          int proxyPort = 0, const QString &proxyUser = "",
                          const QString &proxyPassword = "",
                          const QString &proxyAuth = "ANY");
     static bool checkURL(const QString &url);
+    static void networkChanged();
+    // Asynchronous versions run on NGIOExecutor, see ngThen in core/async.h
+    static QFuture<QMap<QString, QVariant>> getJsonAsMapAsync(const QString &url);
+    static QFuture<QString> getJsonAsStringAsync(const QString &url);
+    static QFuture<QString> getAsStringAsync(const QString &url);
+    static QFuture<bool> getFileAsync(const QString &url, const QString &path);
+    static QFuture<QString> uploadFileAsync(const QString &url,
+                                            const QString &path,
+                                            const QString &name);
+    static QFuture<NGHTTPResponse> postAsync(const QString &url,
+                                             const QByteArray &body,
+                                             const QString &contentType = "application/json",
+                                             const QString &method = "POST");
+    static QFuture<bool> checkURLAsync(const QString &url);
+    static void setCheckURLTTL(int msec);
+    static void setTransport(QSharedPointer<IHTTPTransport> transport);
+    static bool startRecording(const QString &path);
+    static void stopRecording();
+    static bool startReplay(const QString &path, double pace = 0.0);
+    static NGHTTPResponse lastResult();
     static NGRequest &instance();
 
 public:
@@ -66,6 +98,11 @@ public:
     const QString authHeader(const QString &url);
     const QMap<QString, QString> properties(const QString &url) const;
     char **baseOptions() const;
+    const char * const *sharedBaseOptions() const;
+    QSharedPointer<IHTTPTransport> transport() const;
+    NGHTTPResponse fetch(const QString &url, char **options,
+                         NGHTTPWriteFunc write = nullptr,
+                         void *writeArg = nullptr) const;
     QString lastError() const;
     void resetError();
 
@@ -79,14 +116,17 @@ protected:
 private:
     bool addAuthURLImpl(const QString &basicUrl, const QString &newUrl);
     void removeAuthURLImpl(const QString &url);
+    QSharedPointer<IHTTPAuth> findAuth(const QString &url) const;
 
     QMap<QString, QSharedPointer<IHTTPAuth>> m_auths;
+    QSharedPointer<IHTTPTransport> m_transport;
+    mutable QMutex m_transportMutex;
     QString m_connTimeout;
     QString m_timeout;
     QString m_maxRetry;
     QString m_retryDelay;
     QString m_certPem;
-    QString m_detailedError;
+    char **m_baseOptions;
 };
 
 
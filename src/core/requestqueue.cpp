@@ -0,0 +1,495 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/requestqueue.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+#include "core/executor.h"
+#include "core/request.h"
+
+constexpr quint32 journalMagic = 0x4E475251; // NGRQ
+constexpr quint16 journalVersion = 1;
+// Bodies smaller than this are stored as is
+constexpr int compressThreshold = 256;
+// Journal is rewritten when it holds more removed requests than this
+constexpr int compactThreshold = 64;
+
+enum JournalRecord : quint8 {
+    RecordAdd = 1,
+    RecordRemove = 2
+};
+
+static void writeRequest(QDataStream &stream, const NGQueuedRequest &request)
+{
+    bool compressed = request.body.size() >= compressThreshold;
+    stream << static_cast<quint8>(RecordAdd) << request.id << request.method
+           << request.url << compressed
+           << (compressed ? qCompress(request.body) : request.body)
+           << request.contentType << request.filePath << request.fileName;
+}
+
+static bool readRequest(QDataStream &stream, NGQueuedRequest &request)
+{
+    bool compressed;
+    QByteArray body;
+    stream >> request.id >> request.method >> request.url >> compressed >> body
+           >> request.contentType >> request.filePath >> request.fileName;
+    if(stream.status() != QDataStream::Ok) {
+        return false;
+    }
+    request.body = compressed ? qUncompress(body) : body;
+    return true;
+}
+
+// Network errors, timeouts, throttling and server errors may pass later
+static bool isTransient(int status, int error)
+{
+    if(status == 0) {
+        return error != 0;
+    }
+    return status == 408 || status == 429 || status >= 500;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Request execution
+////////////////////////////////////////////////////////////////////////////////
+
+// Lets executor tasks report results only while queue exists
+struct NGRequestQueueGuard {
+    QMutex mutex;
+    NGRequestQueue *queue;
+};
+
+static void sendRequest(std::shared_ptr<NGRequestQueueGuard> guard,
+                        const NGQueuedRequest &request)
+{
+    NGHTTPResponse response;
+    QByteArray body;
+    if(request.filePath.isEmpty()) {
+        response = NGRequest::post(request.url, request.body,
+                                   request.contentType, request.method);
+        body = response.body();
+    }
+    else {
+        body = NGRequest::uploadFile(request.url, request.filePath,
+                                     request.fileName).toUtf8();
+        response = NGRequest::lastResult();
+        // Set if upload failed before request (i.e. old GDAL)
+        QString error = NGRequest::instance().lastError();
+        if(!error.isEmpty() && response.errorMessage.isEmpty()) {
+            response.errorMessage = error;
+        }
+    }
+
+    QMutexLocker locker(&guard->mutex);
+    if(guard->queue == nullptr) {
+        return;
+    }
+    QMetaObject::invokeMethod(guard->queue, "onRequestDone",
+                              Qt::QueuedConnection,
+                              Q_ARG(quint64, request.id),
+                              Q_ARG(int, response.status),
+                              Q_ARG(int, response.error),
+                              Q_ARG(QString, response.errorMessage),
+                              Q_ARG(QByteArray, body));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NGRequestQueue
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Open queue journal. Requests left from previous run are loaded.
+ * @param journalPath Journal file path.
+ * @param parent Parent object.
+ */
+NGRequestQueue::NGRequestQueue(const QString &journalPath, QObject *parent) :
+    QObject(parent),
+    m_journalPath(journalPath),
+    m_journal(journalPath),
+    m_guard(new NGRequestQueueGuard),
+    m_nextId(1),
+    m_removed(0),
+    m_batchSize(16),
+    m_maxConcurrent(1),
+    m_started(0),
+    m_replaying(false),
+    m_stopping(false),
+    m_persistent(true)
+{
+    m_guard->queue = this;
+    if(load()) {
+        // Drop removed and truncated records left from previous run
+        compact();
+        return;
+    }
+
+    // Keep unreadable journal for recovery and start the new one
+    m_requests.clear();
+    QString badPath = QString("%1.%2.bad").arg(m_journalPath)
+            .arg(QDateTime::currentMSecsSinceEpoch());
+    if(QFile::rename(m_journalPath, badPath)) {
+        qDebug() << "Request queue journal moved to" << badPath;
+        compact();
+    }
+    else {
+        qDebug() << "Request queue works without journal" << m_journalPath;
+        m_persistent = false;
+    }
+}
+
+NGRequestQueue::~NGRequestQueue()
+{
+    // Requests being sent are completed, but not reported
+    QMutexLocker locker(&m_guard->mutex);
+    m_guard->queue = nullptr;
+}
+
+/**
+ * @brief Add request to queue.
+ * @param method HTTP method (POST, PUT, PATCH, DELETE).
+ * @param url Request URL.
+ * @param body Request body. Binary bodies with zero bytes are not supported,
+ * use enqueueUpload for them.
+ * @param contentType Body content type.
+ * @return Request id or 0 if body contains zero bytes.
+ */
+quint64 NGRequestQueue::enqueue(const QString &method, const QString &url,
+                                const QByteArray &body,
+                                const QString &contentType)
+{
+    // Body is sent as C string POSTFIELDS and would be truncated
+    if(body.contains('\0')) {
+        qDebug() << "Request body with zero bytes is not queued" << url;
+        return 0;
+    }
+
+    NGQueuedRequest request;
+    request.id = m_nextId++;
+    request.method = method.toUpper();
+    request.url = url;
+    request.body = body;
+    request.contentType = contentType;
+    m_requests.append(request);
+    appendAdd(request);
+    return request.id;
+}
+
+/**
+ * @brief Add file upload to queue (see NGRequest::uploadFile). File must
+ * exist until request is sent.
+ * @param url Upload URL.
+ * @param path File path.
+ * @param name Name in form.
+ * @return Request id.
+ */
+quint64 NGRequestQueue::enqueueUpload(const QString &url, const QString &path,
+                                      const QString &name)
+{
+    NGQueuedRequest request;
+    request.id = m_nextId++;
+    request.method = QLatin1String("POST");
+    request.url = url;
+    request.filePath = path;
+    request.fileName = name;
+    m_requests.append(request);
+    appendAdd(request);
+    return request.id;
+}
+
+/**
+ * @brief Remove request from queue. Request already being sent is not
+ * cancelled.
+ * @param id Request id.
+ * @return true if request was in queue.
+ */
+bool NGRequestQueue::remove(quint64 id)
+{
+    for(int i = 0; i < m_requests.size(); ++i) {
+        if(m_requests[i].id == id) {
+            m_requests.removeAt(i);
+            appendRemove(id);
+            return true;
+        }
+    }
+    return false;
+}
+
+QList<NGQueuedRequest> NGRequestQueue::requests() const
+{
+    return m_requests;
+}
+
+int NGRequestQueue::size() const
+{
+    return m_requests.size();
+}
+
+bool NGRequestQueue::isEmpty() const
+{
+    return m_requests.isEmpty();
+}
+
+bool NGRequestQueue::isReplaying() const
+{
+    return m_replaying;
+}
+
+/**
+ * @brief Set maximum number of requests in one batch. Next batch starts when
+ * all requests of previous batch are finished.
+ */
+void NGRequestQueue::setBatchSize(int size)
+{
+    m_batchSize = qMax(1, size);
+}
+
+/**
+ * @brief Set number of requests sent in parallel. Default is 1, so requests
+ * reach server in strict order. With more requests in flight, requests
+ * following a failed one may reach server and are sent again on the next
+ * replay.
+ */
+void NGRequestQueue::setMaxConcurrent(int count)
+{
+    m_maxConcurrent = qMax(1, count);
+}
+
+/**
+ * @brief Send queued requests. Call when endpoint becomes available.
+ * requestFinished is emitted for every sent request and replayFinished when
+ * queue is empty or replay stopped on error.
+ */
+void NGRequestQueue::replay()
+{
+    if(m_replaying) {
+        return;
+    }
+    if(m_requests.isEmpty()) {
+        emit replayFinished(0);
+        return;
+    }
+    m_replaying = true;
+    startBatch();
+}
+
+void NGRequestQueue::startBatch()
+{
+    m_batch = m_requests.mid(0, m_batchSize);
+    m_results.clear();
+    m_started = 0;
+    m_stopping = false;
+    for(int i = 0; i < m_maxConcurrent; ++i) {
+        startNext();
+    }
+}
+
+void NGRequestQueue::startNext()
+{
+    if(m_stopping || m_started >= m_batch.size()) {
+        return;
+    }
+    std::shared_ptr<NGRequestQueueGuard> guard = m_guard;
+    NGQueuedRequest request = m_batch[m_started++];
+    NGIOExecutor::instance().start([guard, request]() {
+        sendRequest(guard, request);
+    });
+}
+
+void NGRequestQueue::onRequestDone(quint64 id, int status, int error,
+                                   const QString &errorMessage,
+                                   const QByteArray &body)
+{
+    Result result = { status, error, errorMessage, body };
+    m_results[id] = result;
+    bool success = error == 0 && errorMessage.isEmpty();
+    if(!success && isTransient(status, error)) {
+        // Endpoint is not reachable, do not send the rest
+        m_stopping = true;
+    }
+    startNext();
+    if(m_results.size() == m_started &&
+            (m_stopping || m_started == m_batch.size())) {
+        finishBatch();
+    }
+}
+
+void NGRequestQueue::finishBatch()
+{
+    // Requests are removed in order up to the first transient failure. The
+    // failed request and all after it stay in queue for the next replay.
+    bool stop = false;
+    for(const NGQueuedRequest &request : m_batch) {
+        auto it = m_results.constFind(request.id);
+        if(stop || it == m_results.constEnd()) {
+            stop = true;
+            break;
+        }
+        const Result &result = it.value();
+        bool success = result.error == 0 && result.errorMessage.isEmpty();
+        if(!success && isTransient(result.status, result.error)) {
+            stop = true;
+        }
+        else {
+            // May be removed by user while sending
+            remove(request.id);
+        }
+        emit requestFinished(request.id, success, result.status,
+                             result.errorMessage, result.body);
+    }
+    stop = stop || m_stopping;
+    m_batch.clear();
+    m_results.clear();
+
+    if(m_removed > compactThreshold) {
+        compact();
+    }
+
+    if(stop || m_requests.isEmpty()) {
+        m_replaying = false;
+        emit replayFinished(m_requests.size());
+        return;
+    }
+    startBatch();
+}
+
+bool NGRequestQueue::load()
+{
+    QFile file(m_journalPath);
+    if(!file.exists()) {
+        return true;
+    }
+    if(!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to open request queue journal" << m_journalPath;
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic;
+    quint16 version;
+    stream >> magic >> version;
+    if(magic != journalMagic || version > journalVersion) {
+        qDebug() << "Unsupported request queue journal" << m_journalPath;
+        return false;
+    }
+
+    while(!stream.atEnd()) {
+        quint8 type;
+        stream >> type;
+        if(type == RecordAdd) {
+            NGQueuedRequest request;
+            if(!readRequest(stream, request)) {
+                qDebug() << "Request queue journal is truncated" << m_journalPath;
+                break;
+            }
+            m_requests.append(request);
+            m_nextId = qMax(m_nextId, request.id + 1);
+        }
+        else if(type == RecordRemove) {
+            quint64 id;
+            stream >> id;
+            if(stream.status() != QDataStream::Ok) {
+                qDebug() << "Request queue journal is truncated" << m_journalPath;
+                break;
+            }
+            for(int i = 0; i < m_requests.size(); ++i) {
+                if(m_requests[i].id == id) {
+                    m_requests.removeAt(i);
+                    break;
+                }
+            }
+        }
+        else {
+            qDebug() << "Request queue journal is corrupted" << m_journalPath;
+            break;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Rewrite journal with current requests only. File is replaced
+ * atomically, so crash during compaction does not lose requests.
+ */
+bool NGRequestQueue::compact()
+{
+    if(!m_persistent) {
+        return false;
+    }
+    m_journal.close();
+
+    QSaveFile file(m_journalPath);
+    if(!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to write request queue journal" << m_journalPath;
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << journalMagic << journalVersion;
+    for(const NGQueuedRequest &request : m_requests) {
+        writeRequest(stream, request);
+    }
+    if(!file.commit()) {
+        qDebug() << "Failed to write request queue journal" << m_journalPath;
+        return false;
+    }
+    m_removed = 0;
+    return openJournal();
+}
+
+bool NGRequestQueue::openJournal()
+{
+    if(!m_journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "Failed to open request queue journal" << m_journalPath;
+        return false;
+    }
+    // Bodies may hold private data
+    m_journal.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    return true;
+}
+
+void NGRequestQueue::appendAdd(const NGQueuedRequest &request)
+{
+    if(!m_journal.isOpen()) {
+        return;
+    }
+    QDataStream stream(&m_journal);
+    stream.setVersion(QDataStream::Qt_5_0);
+    writeRequest(stream, request);
+    m_journal.flush();
+}
+
+void NGRequestQueue::appendRemove(quint64 id)
+{
+    m_removed++;
+    if(!m_journal.isOpen()) {
+        return;
+    }
+    QDataStream stream(&m_journal);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << static_cast<quint8>(RecordRemove) << id;
+    m_journal.flush();
+}
@@ -0,0 +1,125 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGCORE_REQUESTQUEUE_H
+#define NGCORE_REQUESTQUEUE_H
+
+#include "core/core.h"
+
+#include <QFile>
+#include <QList>
+#include <QMap>
+#include <QObject>
+
+#include <memory>
+
+/**
+ * @brief The NGQueuedRequest class is mutating request waiting in
+ * NGRequestQueue. Requests with file path are sent as form file upload.
+ */
+struct NGQueuedRequest
+{
+    quint64 id;
+    QString method;
+    QString url;
+    QByteArray body;
+    QString contentType;
+    QString filePath;
+    QString fileName;
+};
+
+struct NGRequestQueueGuard;
+
+/**
+ * @brief The NGRequestQueue class is durable outbound queue for mutating
+ * requests. Requests are written to the journal file before enqueue returns
+ * and survive application restart. replay sends requests in order by batches,
+ * requests of one batch are executed concurrently. Replay stops on the first
+ * network or server (5xx, 408, 429) error: no new requests are sent and the
+ * failed request and the rest stay in queue for the next replay. Requests rejected by server (other 4xx)
+ * are removed. Requests are executed on NGIOExecutor.
+ */
+class NGCORE_EXPORT NGRequestQueue : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NGRequestQueue(const QString &journalPath,
+                            QObject *parent = nullptr);
+    virtual ~NGRequestQueue() override;
+
+    quint64 enqueue(const QString &method, const QString &url,
+                    const QByteArray &body,
+                    const QString &contentType = "application/json");
+    quint64 enqueueUpload(const QString &url, const QString &path,
+                          const QString &name);
+    bool remove(quint64 id);
+    QList<NGQueuedRequest> requests() const;
+    int size() const;
+    bool isEmpty() const;
+    bool isReplaying() const;
+    void setBatchSize(int size);
+    void setMaxConcurrent(int count);
+
+public slots:
+    void replay();
+
+signals:
+    void requestFinished(quint64 id, bool success, int status,
+                         const QString &error, const QByteArray &body);
+    void replayFinished(int remaining);
+
+private slots:
+    void onRequestDone(quint64 id, int status, int error,
+                       const QString &errorMessage, const QByteArray &body);
+
+private:
+    bool load();
+    bool compact();
+    bool openJournal();
+    void appendAdd(const NGQueuedRequest &request);
+    void appendRemove(quint64 id);
+    void startBatch();
+    void startNext();
+    void finishBatch();
+
+private:
+    struct Result {
+        int status;
+        int error;
+        QString errorMessage;
+        QByteArray body;
+    };
+
+    QString m_journalPath;
+    QFile m_journal;
+    QList<NGQueuedRequest> m_requests;
+    QList<NGQueuedRequest> m_batch;
+    QMap<quint64, Result> m_results;
+    std::shared_ptr<NGRequestQueueGuard> m_guard;
+    quint64 m_nextId;
+    int m_removed;
+    int m_batchSize;
+    int m_maxConcurrent;
+    int m_started;
+    bool m_replaying;
+    bool m_stopping;
+    bool m_persistent;
+};
+
+#endif // NGCORE_REQUESTQUEUE_H
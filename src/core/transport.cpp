@@ -0,0 +1,582 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/transport.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QHash>
+#include <QList>
+
+#include "cpl_http.h"
+#include "cpl_string.h"
+#include "gdal_version.h"
+
+#include "core/cplbridge.h"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+constexpr size_t loopbackChunkSize = 16384;
+
+////////////////////////////////////////////////////////////////////////////////
+// NGHTTPTimings
+////////////////////////////////////////////////////////////////////////////////
+
+NGHTTPTimings::NGHTTPTimings() :
+    dns(-1),
+    connect(-1),
+    tls(-1),
+    ttfb(-1),
+    total(-1)
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NGHTTPResponse
+////////////////////////////////////////////////////////////////////////////////
+
+NGHTTPResponse::NGHTTPResponse() :
+    status(0),
+    error(0),
+    retries(0),
+    m_data(nullptr),
+    m_size(0)
+{
+
+}
+
+bool NGHTTPResponse::isOk() const
+{
+    return error == 0 && errorMessage.isEmpty();
+}
+
+const char *NGHTTPResponse::data() const
+{
+    return m_owner ? m_data : m_body.constData();
+}
+
+size_t NGHTTPResponse::size() const
+{
+    return m_owner ? m_size : static_cast<size_t>(m_body.size());
+}
+
+QByteArray NGHTTPResponse::body() const
+{
+    if(m_owner) {
+        return QByteArray(m_data, static_cast<int>(m_size));
+    }
+    return m_body;
+}
+
+/**
+ * @brief Response header value. Name comparison is case insensitive.
+ * @param name Header name.
+ * @return Header value or empty array.
+ */
+QByteArray NGHTTPResponse::header(const QByteArray &name) const
+{
+    for(const auto &item : headers) {
+        if(qstricmp(item.first.constData(), name.constData()) == 0) {
+            return item.second;
+        }
+    }
+    return QByteArray();
+}
+
+void NGHTTPResponse::setBody(const QByteArray &body)
+{
+    m_owner.reset();
+    m_data = nullptr;
+    m_size = 0;
+    m_body = body;
+}
+
+/**
+ * @brief Set body referencing external buffer.
+ * @param data Buffer.
+ * @param size Buffer size.
+ * @param owner Keeps buffer alive while response or its copies exist.
+ */
+void NGHTTPResponse::setBody(const char *data, size_t size,
+                             std::shared_ptr<void> owner)
+{
+    m_body.clear();
+    m_data = data;
+    m_size = size;
+    m_owner = owner;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IHTTPTransport
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Request method from CPLHTTPFetch options.
+ * @param options CPLHTTPFetch options.
+ * @return Upper case method name.
+ */
+QString IHTTPTransport::requestMethod(char **options)
+{
+    const char *method = CSLFetchNameValue(options, "CUSTOMREQUEST");
+    if(method != nullptr) {
+        return QString::fromLatin1(method).toUpper();
+    }
+    return CSLFetchNameValue(options, "POSTFIELDS") ? QStringLiteral("POST") :
+                                                      QStringLiteral("GET");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NGCurlTransport
+////////////////////////////////////////////////////////////////////////////////
+
+struct CurlWriteContext {
+    NGHTTPWriteFunc write;
+    void *arg;
+    bool delivered;
+};
+
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(2,3,0)
+static size_t curlWrite(void *buffer, size_t size, size_t count, void *arg)
+{
+    CurlWriteContext *context = static_cast<CurlWriteContext*>(arg);
+    size_t total = size * count;
+    context->delivered = true;
+    if(!context->write(static_cast<const char*>(buffer), total, context->arg)) {
+        return 0; // Abort transfer
+    }
+    return total;
+}
+#endif // GDAL_VERSION_NUM >= 2.3.0
+
+static NGHTTPResponse fetchOnce(const char *url, char **options,
+                                CurlWriteContext &context)
+{
+    NGHTTPWriteFunc write = context.write;
+    CPLHTTPResult *result = nullptr;
+    bool streamed = false;
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(2,3,0)
+    if(write) {
+        result = CPLHTTPFetchEx(url, options, nullptr, nullptr,
+                                curlWrite, &context);
+        streamed = true;
+    }
+    else
+#endif // GDAL_VERSION_NUM >= 2.3.0
+    {
+        result = CPLHTTPFetch(url, options);
+    }
+
+    NGHTTPResponse response;
+    response.error = result->nStatus;
+    if(result->pszErrBuf != nullptr) {
+        response.errorMessage = QString::fromUtf8(result->pszErrBuf);
+        int code = 0;
+        if(sscanf(result->pszErrBuf, "HTTP error code : %d", &code) == 1) {
+            response.status = code;
+        }
+    }
+    if(result->pszContentType != nullptr) {
+        response.contentType = QString::fromUtf8(result->pszContentType);
+    }
+    for(char **header = result->papszHeaders; header && *header; ++header) {
+        char *key = nullptr;
+        const char *value = CPLParseNameValue(*header, &key);
+        if(key != nullptr) {
+            response.headers.append(qMakePair(QByteArray(key),
+                                              QByteArray(value)));
+            CPLFree(key);
+        }
+    }
+
+    if(write && !streamed) {
+        // Old GDAL, pass whole body at once
+        if(response.isOk() && result->nDataLen > 0 &&
+                !write(reinterpret_cast<const char*>(result->pabyData),
+                       static_cast<size_t>(result->nDataLen), context.arg)) {
+            response.errorMessage = QLatin1String("Transfer aborted");
+        }
+        CPLHTTPDestroyResult(result);
+    }
+    else if(result->nDataLen > 0) {
+        // Reference curl buffer without copying
+        std::shared_ptr<CPLHTTPResult> owner(result, CPLHTTPDestroyResult);
+        response.setBody(reinterpret_cast<const char*>(result->pabyData),
+                         static_cast<size_t>(result->nDataLen), owner);
+    }
+    else {
+        CPLHTTPDestroyResult(result);
+    }
+    return response;
+}
+
+// Idle curl handles of one origin and method kept open
+constexpr int maxIdleSessions = 4;
+// Idle handles are closed after this time, servers drop idle connections
+// about the same time anyway
+constexpr qint64 sessionIdleTimeout = 30000;
+
+struct IdleSession {
+    QByteArray name;
+    QElapsedTimer released;
+};
+
+static std::atomic<bool> gConnectionReuse(true);
+static QMutex gSessionMutex;
+// Handles not used by any request now, most recently used last
+static QHash<QByteArray, QList<IdleSession>> gIdleSessions;
+static quint64 gSessionCounter = 0;
+
+static void closeSession(const QByteArray &name)
+{
+    CPLOptions options;
+    options.set(CPLOption::CLOSE_PERSISTENT, name.constData());
+    CPLHTTPDestroyResult(CPLHTTPFetch("", options));
+}
+
+// Must be called with locked gSessionMutex
+static void takeExpiredSessions(QList<QByteArray> &expired)
+{
+    for(auto it = gIdleSessions.begin(); it != gIdleSessions.end();) {
+        QList<IdleSession> &sessions = it.value();
+        while(!sessions.isEmpty() &&
+              sessions.first().released.hasExpired(sessionIdleTimeout)) {
+            expired.append(sessions.takeFirst().name);
+        }
+        if(sessions.isEmpty()) {
+            it = gIdleSessions.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+// scheme://host:port part of URL
+static QByteArray urlOrigin(const char *url)
+{
+    const char *start = strstr(url, "://");
+    if(start == nullptr) {
+        return QByteArray();
+    }
+    const char *end = start + 3;
+    while(*end != 0 && *end != '/' && *end != '?' && *end != '#') {
+        ++end;
+    }
+    return QByteArray(url, static_cast<int>(end - url));
+}
+
+/**
+ * @brief Pool key of request. Handles are not shared between methods, as
+ * CPLHTTPFetch does not reset all options set by previous request (i.e.
+ * POSTFIELDS).
+ */
+static QByteArray sessionKey(const char *url, const QString &method,
+                             char **options)
+{
+    QByteArray origin = urlOrigin(url);
+    if(origin.isEmpty()) {
+        return QByteArray();
+    }
+    QByteArray key = CSLFetchNameValue(options, CPLOption::FORM_FILE_PATH) ?
+                QByteArray("FORM") : method.toLatin1();
+    key += ' ';
+    key += origin;
+    return key;
+}
+
+/**
+ * @brief Take idle handle of origin or name new one. Handle is used by one
+ * request at a time.
+ */
+static QByteArray acquireSession(const QByteArray &key)
+{
+    QList<QByteArray> expired;
+    QByteArray name;
+    {
+        QMutexLocker locker(&gSessionMutex);
+        takeExpiredSessions(expired);
+        auto it = gIdleSessions.find(key);
+        if(it != gIdleSessions.end() && !it.value().isEmpty()) {
+            name = it.value().takeLast().name;
+        }
+        else {
+            name = "NGSTD " + QByteArray::number(++gSessionCounter) + ' ' + key;
+        }
+    }
+    for(const QByteArray &session : expired) {
+        closeSession(session);
+    }
+    return name;
+}
+
+/**
+ * @brief Return handle to pool. Handle is closed if pool of origin is full.
+ */
+static void releaseSession(const QByteArray &key, const QByteArray &name)
+{
+    IdleSession session;
+    session.name = name;
+    session.released.start();
+    QList<QByteArray> expired;
+    {
+        QMutexLocker locker(&gSessionMutex);
+        QList<IdleSession> &sessions = gIdleSessions[key];
+        sessions.append(session);
+        if(sessions.size() > maxIdleSessions) {
+            expired.append(sessions.takeFirst().name);
+        }
+    }
+    for(const QByteArray &expiredName : expired) {
+        closeSession(expiredName);
+    }
+}
+
+/**
+ * @brief Enable or disable curl handle reuse for new requests. Enabled by
+ * default.
+ */
+void NGCurlTransport::setConnectionReuse(bool enable)
+{
+    gConnectionReuse = enable;
+}
+
+/**
+ * @brief Close all idle kept connections. Connections of running requests
+ * return to pool and are closed after idle timeout.
+ */
+void NGCurlTransport::closeConnections()
+{
+    QHash<QByteArray, QList<IdleSession>> sessions;
+    {
+        QMutexLocker locker(&gSessionMutex);
+        sessions.swap(gIdleSessions);
+    }
+    for(const QList<IdleSession> &list : sessions) {
+        for(const IdleSession &session : list) {
+            closeSession(session.name);
+        }
+    }
+}
+
+// libcurl error codes of transient failures, CPLHTTPFetch retried them too
+constexpr int curlOperationTimedOut = 28; // CURLE_OPERATION_TIMEDOUT
+constexpr int curlSSLConnectError = 35;   // CURLE_SSL_CONNECT_ERROR (timeout)
+constexpr int curlGotNothing = 52;        // CURLE_GOT_NOTHING
+constexpr int curlSendError = 55;         // CURLE_SEND_ERROR (reset)
+constexpr int curlRecvError = 56;         // CURLE_RECV_ERROR (reset)
+
+static bool isRetryable(const NGHTTPResponse &response)
+{
+    int status = response.status;
+    if(status == 0) {
+        switch(response.error) {
+        case curlOperationTimedOut:
+        case curlSSLConnectError:
+        case curlGotNothing:
+        case curlSendError:
+        case curlRecvError:
+            return true;
+        default:
+            return false;
+        }
+    }
+    return status == 429 || status == 500 || (status >= 502 && status <= 504);
+}
+
+NGHTTPResponse NGCurlTransport::fetch(const char *url, char **options,
+                                      NGHTTPWriteFunc write, void *writeArg)
+{
+    // Retry here instead of CPLHTTPFetch to know the number of retries
+    int maxRetry = atoi(CSLFetchNameValueDef(options, "MAX_RETRY", "0"));
+    double retryDelay = CPLAtof(CSLFetchNameValueDef(options, "RETRY_DELAY", "30"));
+    CPLOptions attemptOptions(options);
+    attemptOptions.set(CPLOption::MAX_RETRY, "0");
+
+    QByteArray sessionPoolKey, session;
+    if(gConnectionReuse &&
+            CSLFetchNameValue(options, CPLOption::PERSISTENT) == nullptr) {
+        sessionPoolKey = sessionKey(url, requestMethod(options), options);
+        if(!sessionPoolKey.isEmpty()) {
+            session = acquireSession(sessionPoolKey);
+            attemptOptions.set(CPLOption::PERSISTENT, session.constData());
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    CurlWriteContext context = { write, writeArg, false };
+    NGHTTPResponse response;
+    int attempt = 0;
+    for(;; ++attempt) {
+        response = fetchOnce(url, attemptOptions, context);
+        // Streamed data can't be taken back
+        if(attempt >= maxRetry || context.delivered ||
+                !isRetryable(response)) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(
+            static_cast<qint64>(retryDelay * 1000)));
+        retryDelay *= 2;
+    }
+    response.retries = attempt;
+    response.timings.total = timer.nsecsElapsed() / 1000;
+    if(!session.isEmpty()) {
+        releaseSession(sessionPoolKey, session);
+    }
+    return response;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NGLoopbackTransport
+////////////////////////////////////////////////////////////////////////////////
+
+NGLoopbackTransport::NGLoopbackTransport() :
+    m_latency(0),
+    m_bandwidth(0),
+    m_requestCount(0)
+{
+
+}
+
+/**
+ * @brief Add canned response. Responses with status 400 and above are
+ * reported as errors as CPLHTTPFetch does.
+ * @param url URL to serve. Query part must match too.
+ * @param body Response body.
+ * @param status HTTP status code.
+ * @param contentType Response content type.
+ * @param method Request method to match or empty for any method.
+ */
+void NGLoopbackTransport::addResponse(const QString &url,
+                                      const QByteArray &body, int status,
+                                      const QString &contentType,
+                                      const QString &method)
+{
+    QMutexLocker locker(&m_mutex);
+    Response response = { status, body, contentType };
+    m_responses[method.toUpper() + QLatin1Char(' ') + url] = response;
+}
+
+void NGLoopbackTransport::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_responses.clear();
+    m_requestCount = 0;
+}
+
+/**
+ * @brief Delay before response starts.
+ * @param msec Milliseconds.
+ */
+void NGLoopbackTransport::setLatency(int msec)
+{
+    QMutexLocker locker(&m_mutex);
+    m_latency = msec;
+}
+
+/**
+ * @brief Body transfer speed.
+ * @param bytesPerSecond Bytes per second, 0 - unlimited.
+ */
+void NGLoopbackTransport::setBandwidth(qint64 bytesPerSecond)
+{
+    QMutexLocker locker(&m_mutex);
+    m_bandwidth = bytesPerSecond;
+}
+
+int NGLoopbackTransport::requestCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_requestCount;
+}
+
+static void transferDelay(size_t size, qint64 bandwidth)
+{
+    if(bandwidth > 0 && size > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(
+            static_cast<qint64>(size) * 1000000 / bandwidth));
+    }
+}
+
+NGHTTPResponse NGLoopbackTransport::fetch(const char *url, char **options,
+                                          NGHTTPWriteFunc write,
+                                          void *writeArg)
+{
+    QString method = requestMethod(options);
+    QString path = QString::fromUtf8(url);
+
+    Response canned = { 404, QByteArray(), QString() };
+    int latency;
+    qint64 bandwidth;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_requestCount++;
+        latency = m_latency;
+        bandwidth = m_bandwidth;
+        auto it = m_responses.constFind(method + QLatin1Char(' ') + path);
+        if(it == m_responses.constEnd()) {
+            it = m_responses.constFind(QLatin1Char(' ') + path);
+        }
+        if(it != m_responses.constEnd()) {
+            canned = it.value();
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    if(latency > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(latency));
+    }
+
+    NGHTTPResponse response;
+    response.timings.ttfb = timer.nsecsElapsed() / 1000;
+    response.status = canned.status;
+    response.contentType = canned.contentType;
+    if(canned.status >= 400) {
+        response.errorMessage = QString("HTTP error code : %1").arg(canned.status);
+    }
+
+    if(write) {
+        size_t offset = 0;
+        size_t size = static_cast<size_t>(canned.body.size());
+        while(offset < size) {
+            size_t chunk = std::min(loopbackChunkSize, size - offset);
+            transferDelay(chunk, bandwidth);
+            if(!write(canned.body.constData() + offset, chunk, writeArg)) {
+                response.errorMessage = QLatin1String("Transfer aborted");
+                break;
+            }
+            offset += chunk;
+        }
+    }
+    else {
+        transferDelay(static_cast<size_t>(canned.body.size()), bandwidth);
+        response.setBody(canned.body);
+    }
+    response.timings.total = timer.nsecsElapsed() / 1000;
+    return response;
+}
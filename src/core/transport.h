@@ -0,0 +1,166 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGCORE_TRANSPORT_H
+#define NGCORE_TRANSPORT_H
+
+#include "core/core.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+
+#include <memory>
+
+/**
+ * @brief Receives response body chunks while downloading. Return false to
+ * abort transfer.
+ */
+typedef bool (*NGHTTPWriteFunc)(const char *data, size_t size, void *arg);
+
+/**
+ * @brief The NGHTTPTimings class holds request phase durations in
+ * microseconds. Phases the transport does not report are -1.
+ */
+struct NGCORE_EXPORT NGHTTPTimings
+{
+    NGHTTPTimings();
+    qint64 dns;
+    qint64 connect;
+    qint64 tls;
+    qint64 ttfb;
+    qint64 total;
+};
+
+/**
+ * @brief The NGHTTPResponse class is a transport independent fetch result.
+ * Body may reference transport owned buffer without copying.
+ */
+class NGCORE_EXPORT NGHTTPResponse
+{
+public:
+    NGHTTPResponse();
+    bool isOk() const;
+    const char *data() const;
+    size_t size() const;
+    QByteArray body() const;
+    QByteArray header(const QByteArray &name) const;
+    void setBody(const QByteArray &body);
+    void setBody(const char *data, size_t size, std::shared_ptr<void> owner);
+
+public:
+    /// HTTP status code or 0 if transport does not report it
+    int status;
+    /// Transport (curl) error code, 0 on success
+    int error;
+    /// Error description, empty on success
+    QString errorMessage;
+    /// Number of retries done by transport
+    int retries;
+    NGHTTPTimings timings;
+    QString contentType;
+    QList<QPair<QByteArray, QByteArray>> headers;
+
+private:
+    QByteArray m_body;
+    const char *m_data;
+    size_t m_size;
+    std::shared_ptr<void> m_owner;
+};
+
+/**
+ * @brief The IHTTPTransport class is base class for NGRequest transports.
+ * Implementations must be thread safe.
+ */
+class NGCORE_EXPORT IHTTPTransport
+{
+public:
+    virtual ~IHTTPTransport() = default;
+    /**
+     * @brief Execute request.
+     * @param url URL to fetch.
+     * @param options CPLHTTPFetch style list of KEY=VALUE options.
+     * @param write If set, body is passed to the callback and is not stored in
+     * response.
+     * @param writeArg Callback argument.
+     * @return Response.
+     */
+    virtual NGHTTPResponse fetch(const char *url, char **options,
+                                 NGHTTPWriteFunc write = nullptr,
+                                 void *writeArg = nullptr) = 0;
+
+protected:
+    static QString requestMethod(char **options);
+};
+
+/**
+ * @brief The NGCurlTransport class is default transport based on GDAL
+ * CPLHTTPFetch (libcurl). Curl handles are pooled per origin and method, so
+ * subsequent requests may reuse connection kept open by the handle instead of
+ * new handshake. Pool keeps up to 4 idle handles per origin and method, handles
+ * idle for 30 seconds are closed.
+ */
+class NGCORE_EXPORT NGCurlTransport : public IHTTPTransport
+{
+public:
+    static void setConnectionReuse(bool enable);
+    static void closeConnections();
+    virtual NGHTTPResponse fetch(const char *url, char **options,
+                                 NGHTTPWriteFunc write = nullptr,
+                                 void *writeArg = nullptr) override;
+};
+
+/**
+ * @brief The NGLoopbackTransport class serves canned responses in process.
+ * Latency and bandwidth can be set to emulate network for load tests.
+ */
+class NGCORE_EXPORT NGLoopbackTransport : public IHTTPTransport
+{
+public:
+    NGLoopbackTransport();
+    void addResponse(const QString &url, const QByteArray &body,
+                     int status = 200,
+                     const QString &contentType = "application/json",
+                     const QString &method = QString());
+    void clear();
+    void setLatency(int msec);
+    void setBandwidth(qint64 bytesPerSecond);
+    int requestCount() const;
+    virtual NGHTTPResponse fetch(const char *url, char **options,
+                                 NGHTTPWriteFunc write = nullptr,
+                                 void *writeArg = nullptr) override;
+
+private:
+    struct Response {
+        int status;
+        QByteArray body;
+        QString contentType;
+    };
+
+    mutable QMutex m_mutex;
+    QMap<QString, Response> m_responses;
+    int m_latency;
+    qint64 m_bandwidth;
+    int m_requestCount;
+};
+
+#endif // NGCORE_TRANSPORT_H
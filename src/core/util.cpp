@@ -20,30 +20,133 @@
 
 #include "core/util.h"
 
+#include "core/cplbridge.h"
+
+#include <climits>
+
+#ifdef NGSTD_NATIVE_JSON
+#include "core/jsonparser.h"
+
+#include <QDebug>
+#endif // NGSTD_NATIVE_JSON
+
+
+QVariant toVariant(const CPLJSONObject &value)
+{
+    switch(value.GetType()) {
+    case CPLJSONObject::Type::Boolean:
+        return value.ToBool();
+    case CPLJSONObject::Type::String:
+        return QString::fromUtf8(value.ToString().c_str());
+    case CPLJSONObject::Type::Integer:
+        return value.ToInteger();
+    case CPLJSONObject::Type::Long:
+        return static_cast<qlonglong>(value.ToLong());
+    case CPLJSONObject::Type::Double:
+        return value.ToDouble();
+    case CPLJSONObject::Type::Object:
+        return toMap(value);
+    case CPLJSONObject::Type::Array:
+    {
+        CPLJSONArray array = value.ToArray();
+        int size = array.Size();
+        QVariantList out;
+        out.reserve(size);
+        for(int i = 0; i < size; ++i) {
+            out.append(toVariant(array[i]));
+        }
+        return out;
+    }
+    case CPLJSONObject::Type::Null:
+        return QVariant();
+    default:
+        return QString::fromUtf8(value.ToString().c_str());
+    }
+}
 
 QMap<QString, QVariant> toMap(const CPLJSONObject &root) {
     QMap<QString, QVariant> out;
     for(const CPLJSONObject &child : root.GetChildren()) {
-        QString name = QString::fromStdString(child.GetName());
-        switch(child.GetType()) {
-        case CPLJSONObject::Type::Boolean:
-            out[name] = child.ToBool();
-            break;
-        case CPLJSONObject::Type::String:
-            out[name] = QString::fromUtf8(child.ToString().c_str());
-            break;
-        case CPLJSONObject::Type::Integer:
-            out[name] = child.ToInteger();
-            break;
-        case CPLJSONObject::Type::Long:
-            out[name] = child.ToLong();
-            break;
-        case CPLJSONObject::Type::Double:
-            out[name] = child.ToDouble();
-            break;
-        default:
-            out[name] = QString::fromUtf8(child.ToString().c_str());
+        out.insert(QString::fromStdString(child.GetName()), toVariant(child));
+    }
+    return out;
+}
+
+/**
+ * @brief Converts only the requested values of the document. Each path is a
+ * slash separated key sequence (a leading slash as in JSON pointer is allowed),
+ * for example "first_name" or "/resource_access/client/roles". Missing values
+ * are not added to the output map.
+ * @param root Document root object.
+ * @param paths List of paths to extract.
+ * @return map of path - value pairs.
+ */
+QMap<QString, QVariant> toMap(const CPLJSONObject &root, const QStringList &paths)
+{
+    QMap<QString, QVariant> out;
+    for(const QString &path : paths) {
+        Utf8 utf8Path(path);
+        const char *objPath = utf8Path.data();
+        if(*objPath == '/') {
+            ++objPath;
+        }
+        CPLJSONObject value = root.GetObj(objPath);
+        if(value.IsValid()) {
+            out[path] = toVariant(value);
         }
     }
     return out;
 }
+
+/**
+ * @brief Parse json document from memory buffer. Depending on build options
+ * document is parsed with built-in parser (WITH_NATIVE_JSON) or GDAL
+ * CPLJSONDocument.
+ * @param data Buffer with json text.
+ * @param size Buffer size in bytes.
+ * @return map of key - value pairs or empty map on error.
+ */
+QMap<QString, QVariant> bufferToMap(const char *data, size_t size)
+{
+#ifdef NGSTD_NATIVE_JSON
+    QMap<QString, QVariant> out;
+    JSONParser parser(data, size);
+    if(!parser.parse(out)) {
+        qDebug() << "Failed to parse json:" << parser.errorMessage();
+        return QMap<QString, QVariant>();
+    }
+    return out;
+#else
+    if(size > INT_MAX) { // LoadMemory takes int size
+        return QMap<QString, QVariant>();
+    }
+    CPLJSONDocument in;
+    if(in.LoadMemory(reinterpret_cast<const GByte*>(data), static_cast<int>(size))) {
+        return toMap(in.GetRoot());
+    }
+    return QMap<QString, QVariant>();
+#endif // NGSTD_NATIVE_JSON
+}
+
+QMap<QString, QVariant> bufferToMap(const char *data, size_t size,
+                                    const QStringList &paths)
+{
+#ifdef NGSTD_NATIVE_JSON
+    QMap<QString, QVariant> out;
+    JSONParser parser(data, size);
+    if(!parser.parse(out, paths)) {
+        qDebug() << "Failed to parse json:" << parser.errorMessage();
+        return QMap<QString, QVariant>();
+    }
+    return out;
+#else
+    if(size > INT_MAX) { // LoadMemory takes int size
+        return QMap<QString, QVariant>();
+    }
+    CPLJSONDocument in;
+    if(in.LoadMemory(reinterpret_cast<const GByte*>(data), static_cast<int>(size))) {
+        return toMap(in.GetRoot(), paths);
+    }
+    return QMap<QString, QVariant>();
+#endif // NGSTD_NATIVE_JSON
+}
@@ -22,8 +22,15 @@
 
 #include "core/core.h"
 
+#include <QStringList>
+
 #include "cpl_json.h"
 
+QVariant toVariant(const CPLJSONObject &value);
 QMap<QString, QVariant> toMap(const CPLJSONObject &root);
+QMap<QString, QVariant> toMap(const CPLJSONObject &root, const QStringList &paths);
+QMap<QString, QVariant> bufferToMap(const char *data, size_t size);
+QMap<QString, QVariant> bufferToMap(const char *data, size_t size,
+                                    const QStringList &paths);
 
 #endif // NGSTD_UTIL_H
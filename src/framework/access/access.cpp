@@ -23,29 +23,26 @@
 #include <QByteArray>
 #include "framework/sentryreporter.h"
 
-#if QT_VERSION >= 0x050000
-    #include <QtConcurrent/QtConcurrent>
-#else
-    #include <qtconcurrentrun.h>
-#endif // QT_VERSION >= 0x050000
-
 #include <QCoreApplication>
 #include <QCryptographicHash>
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QMainWindow>
 #include <QMessageBox>
 #include <QPainter>
-#include <QSettings>
-#include <QTextStream>
-
-#include <openssl/pem.h>
-#include <openssl/rsa.h>
-
-#include "cpl_json.h"
 
+#include "accesssettings.h"
+#include "async.h"
+#include "eventchannel.h"
+#include "executor.h"
+#include "jwt.h"
+#include "licensestate.h"
 #include "request.h"
 #include "signserver.h"
+#include "signverifier.h"
 #include "version.h"
 
 constexpr const char *apiEndpointSubpath = "/api/v1";
@@ -61,6 +58,10 @@ constexpr const char *defaultScope = "user_info.read";
 constexpr const char *defaultEndpoint = "https://my.nextgis.com";
 constexpr const char *defaultAvatar = ":/icons/person-blue.svg";
 
+// Polling interval grows up to this times check timeout while endpoint state
+// does not change
+constexpr int maxCheckBackoff = 8;
+
 
 static QStringList formOriginsList(NGAccess::AuthSourceType type,
                                    const QString &url1, const QString &url2) {
@@ -74,6 +75,59 @@ static QStringList formOriginsList(NGAccess::AuthSourceType type,
     return urls;
 }
 
+static QVariantMap supportInfo(NGAccessSettings *settings)
+{
+    QVariantMap out;
+    for(const QString &key : {"supported", "user_id", "start_date", "end_date", "sign"}) {
+        out[key] = settings->value(key);
+    }
+    return out;
+}
+
+// Does not use NGAccess members, so may be called from any thread
+static bool verifySupportInfo(NGSignVerifier *verifier, const QString &keyPath,
+                              NGAccess::AuthSourceType type, const QVariantMap &info)
+{
+    if(type != NGAccess::AuthSourceType::NGID) {
+        return false;
+    }
+
+    // Read user id, start/end dates, account type
+    QString userId, startDate, endDate, accountType("true"), sign;
+    bool supported = info.value("supported").toBool();
+    if(!supported) {
+        NGAccess::instance().logMessage("Account is not supported", NGAccess::LogLevel::Warning);
+        return false;
+    }
+
+    userId = info.value("user_id").toString();
+    startDate = info.value("start_date").toString();
+    endDate = info.value("end_date").toString();
+    sign = info.value("sign").toString();
+
+    QString sMessage = userId + startDate + endDate + accountType;
+
+    QByteArray baMessage = sMessage.toUtf8();
+    QByteArray baSignature = QByteArray::fromBase64(sign.toUtf8());
+
+    QString errorMsg;
+    bool verify = verifier->verify(keyPath, baMessage, baSignature, errorMsg);
+    if(!verify) {
+        NGAccess::instance().logMessage(errorMsg, NGAccess::LogLevel::Error);
+        NGAccess::instance().logMessage("Account is supported. Verify failed", NGAccess::LogLevel::Error);
+        return false;
+    }
+
+    QDate start = QDate::fromString(startDate, "yyyy-MM-dd");
+    QDate end = QDate::fromString(endDate, "yyyy-MM-dd");
+    bool out = QDate::currentDate() >= start && QDate::currentDate() <= end;
+    if(!out) {
+        NGAccess::instance().logMessage("Account is supported. Verify success. Period expired.",
+                                        NGAccess::LogLevel::Warning);
+    }
+    return out;
+}
+
 NGAccess &NGAccess::instance()
 {
     static NGAccess s;
@@ -127,6 +181,11 @@ NGAccess::NGAccess() :
     m_authorized(false),
     m_supported(false),
     m_endpointAvailable(false),
+    m_checkTimeout(0),
+    m_eventChannel(new NGEventChannel(this)),
+    m_settings(new NGAccessSettings(this)),
+    m_signVerifier(new NGSignVerifier),
+    m_license(new NGLicenseState(this)),
     m_signInEvent(new SignInEvent(this)),
     m_scope(QLatin1String(defaultScope)),
     m_endpoint(QLatin1String(defaultEndpoint)),
@@ -135,7 +194,9 @@ NGAccess::NGAccess() :
     m_logoutEndpoint(QString()),
     m_authType(AuthSourceType::NGID),
     m_avatar(QIcon(defaultAvatar)),
-    m_codeChallenge(false)
+    m_codeChallenge(false),
+    m_ready(false),
+    m_warmUpGeneration(0)
 {
     // Setup license key file
     QFileInfo appDir(QCoreApplication::applicationDirPath());
@@ -152,18 +213,25 @@ NGAccess::NGAccess() :
 #else
     m_licenseDir = QLatin1String("/usr/share/license");
 #endif
+    m_license->setPath(m_licenseDir);
 
-    m_updateUserInfoWatcher = new QFutureWatcher<void>(this);
-    connect(m_updateUserInfoWatcher, SIGNAL(finished()), this,
-            SLOT(onUserInfoUpdated()));
-    m_updateSupportInfoWatcher = new QFutureWatcher<void>(this);
-    connect(m_updateSupportInfoWatcher, SIGNAL(finished()), this,
-            SLOT(onSupportInfoUpdated()));
     m_updateCheckEndpointWatcher = new QFutureWatcher<bool>(this);
     connect(m_updateCheckEndpointWatcher, SIGNAL(finished()), this,
             SLOT(onUpdateCheckEndpoint()));
     connect(&m_checkTimer, SIGNAL(timeout()), this,
             SLOT(checkEndpointAsync()));
+    connect(m_eventChannel, SIGNAL(connected()), this,
+            SLOT(onEventChannelConnected()));
+    connect(m_eventChannel, SIGNAL(disconnected()), this,
+            SLOT(onEventChannelDisconnected()));
+    connect(m_eventChannel, SIGNAL(eventReceived(QString, QByteArray)), this,
+            SLOT(onEvent(QString, QByteArray)));
+    connect(m_license, SIGNAL(changed()), this, SLOT(onLicenseChanged()));
+}
+
+NGAccess::~NGAccess()
+{
+    delete m_signVerifier;
 }
 
 QIcon NGAccess::avatar() const
@@ -208,6 +276,10 @@ QString NGAccess::email() const
 
 void NGAccess::setClientId(const QString &clientId)
 {
+    QElapsedTimer timer;
+    timer.start();
+    m_ready = false;
+    m_startupTimings.clear();
     m_clientId = clientId.trimmed();
 
     QString config;
@@ -229,13 +301,13 @@ void NGAccess::setClientId(const QString &clientId)
     }
 
     // Get user id from config
-    QString settingsFilePath = m_configDir + QDir::separator() + QLatin1String(settingsFile);
-    QSettings settings(settingsFilePath, QSettings::IniFormat);
-    QString ngUsertId = settings.value("user_id").toString();
+    m_settings->load(m_configDir + QDir::separator() + QLatin1String(settingsFile));
+    QString ngUsertId = m_settings->value("user_id").toString();
     m_authorized = !ngUsertId.isEmpty();
+    m_startupTimings["settings"] = timer.nsecsElapsed() / 1000000.0;
 
     if(m_authorized) {
-        // Get user avatar from local folder
+        // Get user avatar from local folder, image is read on first paint
         if(QFileInfo(avatarFilePath()).exists()) {
             m_avatar = QIcon(avatarFilePath());
             if(m_avatar.isNull()) {
@@ -243,50 +315,110 @@ void NGAccess::setClientId(const QString &clientId)
             }
         }
 
-        m_firstName = settings.value("first_name").toString();
-        m_lastName = settings.value("last_name").toString();
-        m_userId = settings.value("user_id").toString();
-        m_email = settings.value("email").toString();
-        m_roles = settings.value("roles").toStringList();
-
-        // Get access, refresh tokens for network requests
-        QString accessToken = settings.value("access_token").toString();
-
-        if(!accessToken.isEmpty()) {
-
-            QMap<QString, QString> options;
-            options["type"] = "bearer";
-            options["clientId"] = m_clientId;
-            options["tokenServer"] = m_tokenEndpoint;
-            options["expiresIn"] = settings.value("expires_in").toString();
+        m_firstName = m_settings->value("first_name").toString();
+        m_lastName = m_settings->value("last_name").toString();
+        m_userId = m_settings->value("user_id").toString();
+        m_email = m_settings->value("email").toString();
+        m_roles = m_settings->value("roles").toStringList();
+    }
+    else if(!isEnterprise()) {
+        m_avatar = QIcon(":/icons/person-blue.svg");
+    }
+    m_startupTimings["identity"] = timer.nsecsElapsed() / 1000000.0;
 
-            QString refreshToken = settings.value("update_token").toString();
+    warmUp();
+}
 
-            options["accessToken"] = accessToken;
-            options["updateToken"] = refreshToken;
+/**
+ * @brief Register stored tokens and verify stored plan out of GUI thread.
+ * Emits ready when finished. Tokens are registered at once as this does not
+ * touch network, so early requests are authorized.
+ */
+void NGAccess::warmUp()
+{
+    QElapsedTimer timer;
+    timer.start();
+    quint64 generation = ++m_warmUpGeneration;
 
-            QStringList urls = formOriginsList(m_authType, m_endpoint, m_userInfoEndpoint);
+    bool authorized = m_authorized;
+    QString accessToken = m_settings->value("access_token").toString();
+    if(authorized && !accessToken.isEmpty()) {
+        // Get access, refresh tokens for network requests
+        QMap<QString, QString> options;
+        options["type"] = "bearer";
+        options["clientId"] = m_clientId;
+        options["tokenServer"] = m_tokenEndpoint;
+        options["expiresIn"] = m_settings->value("expires_in").toString();
+        options["accessToken"] = accessToken;
+        options["updateToken"] = m_settings->value("update_token").toString();
+        QStringList urls = formOriginsList(m_authType, m_endpoint, m_userInfoEndpoint);
+        if(!NGRequest::addAuth(urls, options)) {
+            qDebug() << "Add tokens to NGRequest failed";
+            logMessage("Add tokens to NGRequest failed", LogLevel::Error);
+        }
+    }
+    m_startupTimings["auth"] = timer.nsecsElapsed() / 1000000.0;
+
+    // Worker gets copies only, members may change by next setClientId call
+    NGSignVerifier *verifier = m_signVerifier;
+    QString keyPath = m_configDir + QDir::separator() + QLatin1String(keyFile);
+    AuthSourceType authType = m_authType;
+    QVariantMap info = supportInfo(m_settings);
+
+    m_warmUpFuture = NGIOExecutor::instance().run([authorized, verifier, keyPath,
+                                                   authType, info]() {
+        QVariantMap out;
+        QElapsedTimer phase;
+        phase.start();
+        // Load stored plan file
+        out["supported"] = authorized &&
+                verifySupportInfo(verifier, keyPath, authType, info);
+        out["verify"] = phase.nsecsElapsed() / 1000000.0;
+        return out;
+    });
+
+    ngThen(m_warmUpFuture, this, [this, timer, generation](QFuture<QVariantMap> result) {
+        if(generation != m_warmUpGeneration) {
+            return; // setClientId was called again
+        }
+        QVariantMap out = result.result();
+        m_supported = out.take("supported").toBool();
+        for(auto it = out.constBegin(); it != out.constEnd(); ++it) {
+            m_startupTimings[it.key()] = it.value();
+        }
+        m_startupTimings["warm_up"] = timer.nsecsElapsed() / 1000000.0;
 
-            if(!NGRequest::addAuth(urls, options)) {
-                qDebug() << "Add tokens to NGRequest failed";
-                logMessage("Add tokens to NGRequest failed", LogLevel::Error);
-            }
+        // Request updates user and support info
+        if(m_authorized || isEnterprise()) {
+            updateUserInfoAsync();
+            updateSupportInfoAsync();
         }
 
-        // Load stored plan file
-        m_supported = checkSupported();
+        m_ready = true;
+        qDebug() << "Access startup timings, ms:" << m_startupTimings;
+        emit supportInfoUpdated();
+        emit ready();
+    });
+}
 
-        // Reguest updates user and support info
-        updateUserInfo();
-        updateSupportInfo();
-    }
-    else if(isEnterprise()) {
-        updateUserInfo();
-        updateSupportInfo();
-    }
-    else {
-        m_avatar = QIcon(":/icons/person-blue.svg");
-    }
+/**
+ * @brief Initialization finished: stored tokens are registered in NGRequest
+ * and stored plan is verified.
+ */
+bool NGAccess::isReady() const
+{
+    return m_ready;
+}
+
+/**
+ * @brief Durations of initialization phases in milliseconds. settings and
+ * identity are measured from setClientId start on GUI thread, auth is token
+ * registration from warm up start, verify is background phase of warm up,
+ * warm_up is time from warm up start to ready.
+ */
+QVariantMap NGAccess::startupTimings() const
+{
+    return m_startupTimings;
 }
 
 void NGAccess::setAuthEndpoint(const QString &endpoint)
@@ -309,13 +441,41 @@ void NGAccess::setUseCodeChallenge(bool val)
     m_codeChallenge = val;
 }
 
+/**
+ * @brief Set endpoint polling interval. Interval grows while endpoint state
+ * does not change. Polling is paused while event channel is connected.
+ * @param timeout Interval in milliseconds, 0 disables polling.
+ */
 void NGAccess::setCheckEndpointTimeout(int timeout)
 {
+    m_checkTimeout = timeout;
     if (timeout <= 0) {
         m_checkTimer.stop();
+        return;
+    }
+
+    if (!m_eventChannel->isConnected()) {
+        m_checkTimer.start(timeout);
     }
+}
 
-    m_checkTimer.start(timeout);
+/**
+ * @brief Set Server-Sent Events endpoint for availability, license and profile
+ * change notifications. Events:
+ * - endpoint: {"available": true|false}
+ * - license: support info changed
+ * - profile: user info changed
+ * @param endpoint Event stream URL, empty string closes channel.
+ */
+void NGAccess::setEventEndpoint(const QString &endpoint)
+{
+    QString url = endpoint.trimmed();
+    if (url.isEmpty()) {
+        m_eventChannel->close();
+    }
+    else {
+        m_eventChannel->open(QUrl(url));
+    }
 }
 
 void NGAccess::setScope(const QString &scope)
@@ -382,6 +542,16 @@ QString NGAccess::userInfoEndpoint() const
     return m_userInfoEndpoint;
 }
 
+QString NGAccess::eventEndpoint() const
+{
+    return m_eventChannel->url().toString();
+}
+
+bool NGAccess::isEventChannelConnected() const
+{
+    return m_eventChannel->isConnected();
+}
+
 bool NGAccess::useCodeChallenge() const
 {
     return m_codeChallenge;
@@ -410,12 +580,8 @@ void NGAccess::exit()
 
     m_avatar = QIcon(":/icons/person-blue.svg");
 
-    QString settingsFilePath = m_configDir + QDir::separator() + QLatin1String(settingsFile);
-    QSettings settings(settingsFilePath, QSettings::IniFormat);
-
-    settings.setValue("user_id", "");
-
-    settings.sync();
+    m_settings->setValue("user_id", "");
+    m_settings->sync();
     // logout
     NGRequest::instance().removeAuth(m_endpoint, m_logoutEndpoint);
 
@@ -427,14 +593,12 @@ void NGAccess::exit()
 void NGAccess::save()
 {
     auto properties = NGRequest::instance().properties(m_endpoint);
-    QString settingsFilePath = m_configDir + QDir::separator() + QLatin1String(settingsFile);
-    QSettings settings(settingsFilePath, QSettings::IniFormat);
-
-    settings.setValue("expires_in", properties.value("expiresIn", 0));
-    settings.setValue("update_token", properties.value("updateToken", ""));
-    settings.setValue("access_token", properties.value("accessToken", ""));
-
-    settings.sync();
+    QVariantMap values;
+    values["expires_in"] = properties.value("expiresIn", 0);
+    values["update_token"] = properties.value("updateToken", "");
+    values["access_token"] = properties.value("accessToken", "");
+    m_settings->setValues(values);
+    m_settings->sync();
 }
 
 bool NGAccess::checkEndpoint(const QString &endpoint)
@@ -453,15 +617,26 @@ bool NGAccess::checkEndpoint(const QString &endpoint)
 
 void NGAccess::checkEndpointAsync(const QString &endpoint)
 {
-    QFuture<bool> future = QtConcurrent::run(this, &NGAccess::checkEndpoint, endpoint);
+    QFuture<bool> future = NGIOExecutor::instance().run([this, endpoint]() {
+        return checkEndpoint(endpoint);
+    });
     m_updateCheckEndpointWatcher->setFuture(future);
 }
 
 void NGAccess::onUpdateCheckEndpoint()
 {
+    bool available = m_endpointAvailable;
     if (auto watcher = dynamic_cast<QFutureWatcher<bool>*>(sender()))
         m_endpointAvailable = watcher->future().result();
 
+    // Poll less often while nothing changes
+    if (m_checkTimer.isActive()) {
+        int interval = available == m_endpointAvailable ?
+                    qMin(m_checkTimer.interval() * 2,
+                         m_checkTimeout * maxCheckBackoff) : m_checkTimeout;
+        m_checkTimer.setInterval(interval);
+    }
+
     emit endpointAvailableUpdated();
     emit userInfoUpdated();
 }
@@ -472,8 +647,17 @@ bool NGAccess::isFunctionAvailable(const QString &/*app*/, const QString &/*func
     return isUserSupported();
 }
 
+/**
+ * @brief User has verified plan. Before ready() waits for stored plan
+ * verification, so callers right after setClientId get the stored state.
+ */
 bool NGAccess::isUserSupported() const
 {
+    if(!m_ready && m_warmUpGeneration > 0) {
+        QFuture<QVariantMap> future = m_warmUpFuture;
+        future.waitForFinished();
+        return future.result().value("supported").toBool();
+    }
     return m_supported;
 }
 
@@ -484,8 +668,7 @@ bool NGAccess::isUserAuthorized() const
 
 bool NGAccess::isEnterprise() const
 {
-    QFileInfo licenseJson(QDir(m_licenseDir).filePath("license.json"));
-    return licenseJson.exists() && licenseJson.isFile();
+    return m_license->isEnterprise();
 }
 
 bool NGAccess::isEndpointAvailable() const
@@ -501,65 +684,56 @@ QString NGAccess::getPluginSign(const QString &pluginName, const QString &plugin
     return "";
 }
 
-bool NGAccess::checkSupported()
+/**
+ * @brief Get signs of several plugins at once.
+ * @param plugins Map of plugin name to plugin version.
+ * @return Map of plugin name to sign. Signs are empty if user is not
+ * supported.
+ */
+QMap<QString, QString> NGAccess::getPluginSigns(const QMap<QString, QString> &plugins) const
 {
-    if(m_authType != AuthSourceType::NGID) {
-        return false;
-    }
-
-    // Read user id, start/end dates, account type
-    QString userId, startDate, endDate, accountType("true"), sign;
-    QString settingsFilePath = m_configDir + QDir::separator() + QLatin1String(settingsFile);
-    QSettings settings(settingsFilePath, QSettings::IniFormat);
-    bool supported = settings.value("supported").toBool();
-    if(!supported) {
-        logMessage("Account is not supported", LogLevel::Warning);
-        return false;
+    QMap<QString, QString> out;
+    bool supported = isUserSupported();
+    for(auto it = plugins.constBegin(); it != plugins.constEnd(); ++it) {
+        out[it.key()] = supported ? pluginSign(it.key(), it.value()) : "";
     }
+    return out;
+}
 
-    userId = settings.value("user_id").toString();
-    m_authorized = !userId.isEmpty();
-    startDate = settings.value("start_date").toString();
-    endDate = settings.value("end_date").toString();
-    sign = settings.value("sign").toString();
-
-    QString sMessage = userId + startDate + endDate + accountType;
-
-    QByteArray baMessage = sMessage.toUtf8();
-    QByteArray baSignature = QByteArray::fromBase64(sign.toUtf8());
-
-    QString errorMsg;
-    bool verify = verifyRSASignature(reinterpret_cast<unsigned char*>(baMessage.data()),
-                              static_cast<unsigned int>(baMessage.size()),
-                              reinterpret_cast<unsigned char*>(baSignature.data()),
-                              static_cast<unsigned int>(baSignature.size()),
-                              errorMsg);
-    if(!verify) {
-        logMessage(errorMsg, LogLevel::Error);
-        logMessage("Account is supported. Verify failed", LogLevel::Error);
-        return false;
-    }
+/**
+ * @brief Get signs of several plugins without blocking calling thread. Signs
+ * are computed on NGIOExecutor.
+ * @param plugins Map of plugin name to plugin version.
+ * @return Future with map of plugin name to sign.
+ */
+QFuture<QMap<QString, QString> > NGAccess::getPluginSignsAsync(const QMap<QString, QString> &plugins) const
+{
+    // Support state is changed in GUI thread, read it here
+    bool supported = isUserSupported();
+    return NGIOExecutor::instance().run([this, plugins, supported]() {
+        QMap<QString, QString> out;
+        for(auto it = plugins.constBegin(); it != plugins.constEnd(); ++it) {
+            out[it.key()] = supported ? pluginSign(it.key(), it.value()) : "";
+        }
+        return out;
+    });
+}
 
-    QDate start = QDate::fromString(startDate, "yyyy-MM-dd");
-    QDate end = QDate::fromString(endDate, "yyyy-MM-dd");
-    bool out = QDate::currentDate() >= start && QDate::currentDate() <= end;
-    if(!out) {
-        logMessage("Account is supported. Verify success. Period expired.", LogLevel::Warning);
+bool NGAccess::checkSupported()
+{
+    if(m_authType == AuthSourceType::NGID &&
+            m_settings->value("supported").toBool()) {
+        m_authorized = !m_settings->value("user_id").toString().isEmpty();
     }
-    return out;
+    return verifySupportInfo(m_signVerifier,
+                             m_configDir + QDir::separator() + QLatin1String(keyFile),
+                             m_authType, supportInfo(m_settings));
 }
 
-QString NGAccess::getPublicKey() const 
+QString NGAccess::getPublicKey() const
 {
     QString keyFilePath = m_configDir + QDir::separator() + QLatin1String(keyFile);
-    QFile keyFile(keyFilePath);
-    if(!keyFile.open(QFile::ReadOnly | QFile::Text)) {
-        return "";
-    }
-    QTextStream in(&keyFile);
-    QString fileText = in.readAll();
-    keyFile.close();
-    return fileText;
+    return m_signVerifier->publicKey(keyFilePath);
 }
 
 bool NGAccess::verifyRSASignature(unsigned char *originalMessage,
@@ -580,59 +754,15 @@ bool NGAccess::verifyRSASignature(unsigned char *originalMessage,
         return false;
     }
 
-    // https://gist.github.com/sakamoto-poteko/396f289682089e1d767e
-    // https://stackoverflow.com/questions/9465727/convert-qfile-to-file
+    // Parsed key and results are cached, see NGSignVerifier
     QString keyFilePath = m_configDir + QDir::separator() + QLatin1String(keyFile);
-    QFile keyFile(keyFilePath);
-    if(!keyFile.open(QIODevice::ReadOnly)) {
-        qWarning() << tr("Failed open file %1").arg(keyFilePath);
-        errorMsg = QString("Failed open file %1").arg(keyFilePath);
-        return false;
-    }
-
-    FILE *file = fdopen(keyFile.handle(), "r"); // fopen(keyFilePath.toLatin1().data(), "r");
-    if (!file) {
-        qWarning() << tr("Failed open file %1").arg(keyFilePath);
-        errorMsg = QString("Failed open file %1").arg(keyFilePath);
-        return false;
-    }
-
-    EVP_PKEY *evp_pubkey = PEM_read_PUBKEY(file, nullptr, nullptr, nullptr);
-    if (!evp_pubkey) {
-        qWarning() << "Failed PEM_read_PUBKEY";
-        errorMsg = "Failed PEM_read_PUBKEY";
-        return false;
-    }
-
-    EVP_MD_CTX *ctx = EVP_MD_CTX_create();
-    if (!ctx) {
-        qWarning() << "Failed EVP_MD_CTX_create";
-        errorMsg = "Failed PEM_read_PUBKEY";
-        EVP_PKEY_free(evp_pubkey);
-        return false;
-    }
-
-    if(!EVP_VerifyInit(ctx, EVP_sha256())) {
-        EVP_MD_CTX_destroy(ctx);
-        EVP_PKEY_free(evp_pubkey);
-        qWarning() << "Failed EVP_VerifyInit";
-        errorMsg = "Failed EVP_VerifyInit";
-    }
-
-    if(!EVP_VerifyUpdate(ctx, originalMessage, messageLength)) {
-        EVP_MD_CTX_destroy(ctx);
-        EVP_PKEY_free(evp_pubkey);
-        qWarning() << "Failed EVP_VerifyUpdate";
-        errorMsg = "Failed EVP_VerifyUpdate";
-    }
-    int result = EVP_VerifyFinal(ctx, signature, sigLength, evp_pubkey);
-
-    EVP_MD_CTX_destroy(ctx);
-    EVP_PKEY_free(evp_pubkey);
-
-    qDebug() << "Signature is " << (result == 1 ? "valid" : "invalid");
-
-    return result == 1;
+    QByteArray message = QByteArray::fromRawData(
+                reinterpret_cast<const char*>(originalMessage),
+                static_cast<int>(messageLength));
+    QByteArray sign = QByteArray::fromRawData(
+                reinterpret_cast<const char*>(signature),
+                static_cast<int>(sigLength));
+    return m_signVerifier->verify(keyFilePath, message, sign, errorMsg);
 }
 
 void NGAccess::getTokens(const QString &code, const QString &redirectUri,
@@ -655,31 +785,67 @@ void NGAccess::getTokens(const QString &code, const QString &redirectUri,
         options["codeVerifier"] = verifier;
     }
 
+    // Exchange code for tokens without blocking GUI, then update user info
     QStringList urls = formOriginsList(m_authType, m_endpoint, m_userInfoEndpoint);
-    if(NGRequest::addAuth(urls, options)) {
-        updateUserInfo();
-        updateSupportInfo();
+    QFuture<bool> future = NGIOExecutor::instance().run([urls, options]() {
+        return NGRequest::addAuth(urls, options);
+    });
+    ngThen(future, this, [this](QFuture<bool> result) {
+        if(result.result()) {
+            updateUserInfoAsync();
+            updateSupportInfoAsync();
+
+            save();
+        }
+    });
+}
 
-        save();
+static QString rolesKey(const QString &clientId)
+{
+    return QString("resource_access/%1/roles").arg(clientId);
+}
+
+static QStringList userInfoKeys(enum NGAccess::AuthSourceType type,
+                                const QString &clientId)
+{
+    QStringList keys;
+    if(type == NGAccess::AuthSourceType::NGID) {
+        keys << "first_name" << "last_name" << "email" << "nextgis_guid";
+    }
+    else {
+        keys << "given_name" << "family_name" << "email" << "sub"
+             << "avatar_url" << rolesKey(clientId);
     }
+    return keys;
 }
 
-static QMap<QString, QVariant> userInfoFromJWT(const QString &endPoint) {
+static QMap<QString, QVariant> userInfoFromJWT(const QString &endPoint,
+                                               const QStringList &keys) {
     QMap<QString, QVariant> result;
-    // Update tokens
-    NGRequest::getAuthHeader(endPoint);
-    QMap<QString, QString> properties = NGRequest::instance().properties(endPoint);
-    QString accessToken = properties["accessToken"];
-    QStringList jwtParts = accessToken.split(QLatin1Char('.'), QString::SkipEmptyParts);
-    if(jwtParts.size() != 3) {
+    NGJWT jwt = NGJWT::decode(
+                NGRequest::instance().properties(endPoint)["accessToken"]);
+    if(jwt.isExpired(2)) {
+        // Update tokens
+        NGRequest::getAuthHeader(endPoint);
+        jwt = NGJWT::decode(
+                    NGRequest::instance().properties(endPoint)["accessToken"]);
+    }
+    if(!jwt.isValid()) {
         return result;
     }
-    auto decoded = fromBase64(jwtParts[1]);
-    return memJsonToMap(decoded);
+
+    for(const QString &key : keys) {
+        QVariant value = jwt.value(key);
+        if(value.isValid()) {
+            result[key] = value;
+        }
+    }
+    return result;
 }
 
-extern void updateUserInfoFunction(const QString &configDir,
-                                   const QString &licenseDir,
+extern void updateUserInfoFunction(NGAccessSettings *settings,
+                                   NGLicenseState *license,
+                                   const QString &configDir,
                                    const QString &clientId,
                                    const QString &endPoint,
                                    enum NGAccess::AuthSourceType type)
@@ -688,16 +854,16 @@ extern void updateUserInfoFunction(const QString &configDir,
     QStringList rolesList;
 
     // Check local files before request my.nextgis.com
-    QFileInfo licenseJson(QDir(licenseDir).filePath("license.json"));
+    QStringList keys = userInfoKeys(type, clientId);
     QMap<QString, QVariant> result;
-    if(licenseJson.exists() && licenseJson.isFile()) {
-        result = jsonToMap(licenseJson.absoluteFilePath());
+    if(license->isEnterprise()) {
+        result = license->values(keys);
     }
     else {
         // Get info from jwt
-        result = userInfoFromJWT(endPoint);
+        result = userInfoFromJWT(endPoint, keys);
         if(result.empty()) {
-            result = NGRequest::getJsonAsMap(endPoint);
+            result = NGRequest::getJsonAsMap(endPoint, keys);
         }
     }
 
@@ -730,60 +896,50 @@ extern void updateUserInfoFunction(const QString &configDir,
                     .arg(emailHash);
         }
         // Get roles
-        std::string ra = result["resource_access"].toString().toStdString();
-        if(!ra.empty()) {
-            CPLJSONDocument doc;
-            if(doc.LoadMemory(ra)) {
-                auto root = doc.GetRoot();
-                auto rolesArray = root.GetArray(clientId.toStdString() + "/roles");
-                for(int i = 0; i < rolesArray.Size(); ++i) {
-                    rolesList.append(rolesArray[i].ToString().c_str());
-                }
-            }
-        }
+        rolesList = result[rolesKey(clientId)].toStringList();
     }
 
-    QString settingsFilePath = configDir + QDir::separator() + QLatin1String(settingsFile);
-    QSettings settings(settingsFilePath, QSettings::IniFormat);
-
     if(userId.isEmpty()) {
         NGAccess::instance().logMessage(QString("Get user info map size of %1").arg(result.size()), NGAccess::LogLevel::Warning);
     }
 
-    settings.setValue("user_id", userId);
-    settings.setValue("first_name", firstName);
-    settings.setValue("last_name", lastName);
-    settings.setValue("email", email);
-    settings.setValue("roles", rolesList);
+    QVariantMap values;
+    values["user_id"] = userId;
+    values["first_name"] = firstName;
+    values["last_name"] = lastName;
+    values["email"] = email;
+    values["roles"] = rolesList;
+    settings->setValues(values);
 
     // Get avatar
     QString avatarPath = configDir + QDir::separator() + QLatin1String(avatarFile);
-    QFileInfo avatar(QDir(licenseDir).filePath(avatarFile));
-    if(avatar.exists() && avatar.isFile()) {
+    if(license->hasFile(QLatin1String(avatarFile))) {
         if(QFile::exists(avatarPath)) {
             QFile::remove(avatarPath);
         }
-        QFile::copy(avatar.absoluteFilePath(), avatarPath);
+        QFile::copy(license->filePath(QLatin1String(avatarFile)), avatarPath);
     }
     else {
         NGRequest::getFile(avatarUrl, avatarPath);
     }
 }
 
-extern void updateSupportInfoFunction(const QString &configDir,
-                                      const QString &licenseDir,
+extern void updateSupportInfoFunction(NGAccessSettings *settings,
+                                      NGLicenseState *license,
+                                      const QString &configDir,
                                       const QString &endPoint)
 {
     bool supported = false;
     QString sign, start_date, end_date, userId;
     // Check local files before request my.nextgis.com
-    QFileInfo licenseJson(QDir(licenseDir).filePath("license.json"));
+    QStringList keys;
+    keys << "supported" << "sign" << "start_date" << "end_date" << "nextgis_guid";
     QMap<QString, QVariant> result;
-    if(licenseJson.exists() && licenseJson.isFile()) {
-        result = jsonToMap(licenseJson.absoluteFilePath());
+    if(license->isEnterprise()) {
+        result = license->values(keys);
     }
     else {
-        result = NGRequest::getJsonAsMap(QString("%1%2/support_info/").arg(endPoint).arg(apiEndpointSubpath));
+        result = NGRequest::getJsonAsMap(QString("%1%2/support_info/").arg(endPoint).arg(apiEndpointSubpath), keys);
     }
 
     supported = result["supported"].toBool();
@@ -792,23 +948,21 @@ extern void updateSupportInfoFunction(const QString &configDir,
     end_date = result["end_date"].toString();
     userId = result["nextgis_guid"].toString();
 
-    QString settingsFilePath = configDir + QDir::separator() + QLatin1String(settingsFile);
-    QSettings settings(settingsFilePath, QSettings::IniFormat);
-    settings.setValue("supported", supported);
-    settings.setValue("user_id", userId);
+    QVariantMap values;
+    values["supported"] = supported;
+    values["user_id"] = userId;
 
     if(supported) {
-        settings.setValue("sign", sign);
-        settings.setValue("start_date", start_date);
-        settings.setValue("end_date", end_date);
+        values["sign"] = sign;
+        values["start_date"] = start_date;
+        values["end_date"] = end_date;
 
         QString pkPath = configDir + QDir::separator() + QLatin1String(keyFile);
-        QFileInfo pk(QDir(licenseDir).filePath(keyFile));
-        if(pk.exists() && pk.isFile()) {
+        if(license->hasFile(QLatin1String(keyFile))) {
             if(QFile::exists(pkPath)) {
                 QFile::remove(pkPath);
             }
-            QFile::copy(pk.absoluteFilePath(), pkPath);
+            QFile::copy(license->filePath(QLatin1String(keyFile)), pkPath);
         }
         else {
             // Get key file
@@ -816,13 +970,12 @@ extern void updateSupportInfoFunction(const QString &configDir,
             NGRequest::getFile(QString("%1%2/rsa_public_key/").arg(endPoint).arg(apiEndpointSubpath), keyFilePath);
         }
     }
+    settings->setValues(values);
 }
 
 void NGAccess::onUserInfoUpdated()
 {
-    QString settingsFilePath = m_configDir + QDir::separator() + QLatin1String(settingsFile);
-    QSettings settings(settingsFilePath, QSettings::IniFormat);
-    QString ngUserId = settings.value("user_id").toString();
+    QString ngUserId = m_settings->value("user_id").toString();
     m_authorized = !ngUserId.isEmpty();
     if(m_authorized) {
         if(QFileInfo(avatarFilePath()).exists()) {
@@ -835,11 +988,11 @@ void NGAccess::onUserInfoUpdated()
             m_avatar = QIcon(":/icons/person-blue.svg");
         }
 
-        m_firstName = settings.value("first_name").toString();
-        m_lastName = settings.value("last_name").toString();
-        m_userId = settings.value("user_id").toString();
-        m_email = settings.value("email").toString();
-        m_roles = settings.value("roles").toStringList();
+        m_firstName = m_settings->value("first_name").toString();
+        m_lastName = m_settings->value("last_name").toString();
+        m_userId = m_settings->value("user_id").toString();
+        m_email = m_settings->value("email").toString();
+        m_roles = m_settings->value("roles").toStringList();
     }
 
     emit userInfoUpdated();
@@ -864,25 +1017,111 @@ void NGAccess::onSupportInfoUpdated()
     }
 }
 
-void NGAccess::updateUserInfo() const
+/**
+ * @brief Request user info from server.
+ * @return Future which finishes after user info is applied and
+ * userInfoUpdated is emitted. Can be chained with ngThen or co_await.
+ */
+QFuture<void> NGAccess::updateUserInfoAsync()
 {
+    QFutureInterface<void> promise;
+    promise.reportStarted();
+
     auto properties = NGRequest::instance().properties(m_endpoint);
     m_updateToken = properties.value("updateToken", "");
-    QFuture<void> future = QtConcurrent::run(updateUserInfoFunction, m_configDir,
-        m_licenseDir, m_clientId, m_userInfoEndpoint, m_authType);
-    m_updateUserInfoWatcher->setFuture(future);
+    QString configDir = m_configDir, clientId = m_clientId,
+            userInfoEndpoint = m_userInfoEndpoint;
+    AuthSourceType authType = m_authType;
+    NGAccessSettings *settings = m_settings;
+    NGLicenseState *license = m_license;
+    QFuture<void> future = NGIOExecutor::instance().run([=]() {
+        updateUserInfoFunction(settings, license, configDir, clientId,
+                               userInfoEndpoint, authType);
+    });
+    ngThen(future, this, [this, promise](QFuture<void>) mutable {
+        onUserInfoUpdated();
+        promise.reportFinished();
+    });
+    return promise.future();
 }
 
-void NGAccess::updateSupportInfo() const
+/**
+ * @brief Request support info from server. Finishes at once if authorization
+ * is not NextGIS ID.
+ * @return Future which finishes after support info is applied and
+ * supportInfoUpdated is emitted.
+ */
+QFuture<void> NGAccess::updateSupportInfoAsync()
 {
+    QFutureInterface<void> promise;
+    promise.reportStarted();
     if(m_authType != AuthSourceType::NGID) {
-        return;
+        promise.reportFinished();
+        return promise.future();
     }
+
     auto properties = NGRequest::instance().properties(m_endpoint);
     m_updateToken = properties.value("updateToken", "");
-    QFuture<void> future = QtConcurrent::run(updateSupportInfoFunction, m_configDir,
-        m_licenseDir, m_endpoint);
-    m_updateSupportInfoWatcher->setFuture(future);
+    QString configDir = m_configDir, endpoint = m_endpoint;
+    NGAccessSettings *settings = m_settings;
+    NGLicenseState *license = m_license;
+    QFuture<void> future = NGIOExecutor::instance().run([=]() {
+        updateSupportInfoFunction(settings, license, configDir, endpoint);
+    });
+    ngThen(future, this, [this, promise](QFuture<void>) mutable {
+        onSupportInfoUpdated();
+        promise.reportFinished();
+    });
+    return promise.future();
+}
+
+void NGAccess::onEventChannelConnected()
+{
+    // Server notifies about changes, polling is not needed
+    m_checkTimer.stop();
+    m_endpointAvailable = true;
+
+    emit endpointAvailableUpdated();
+    emit userInfoUpdated();
+}
+
+void NGAccess::onEventChannelDisconnected()
+{
+    if (m_checkTimeout > 0) {
+        m_checkTimer.start(m_checkTimeout);
+    }
+    checkEndpointAsync();
+}
+
+void NGAccess::onEvent(const QString &type, const QByteArray &data)
+{
+    if (type == QLatin1String("endpoint")) {
+        QJsonObject object = QJsonDocument::fromJson(data).object();
+        m_endpointAvailable = object.value("available").toBool(true);
+
+        emit endpointAvailableUpdated();
+        emit userInfoUpdated();
+    }
+    else if (type == QLatin1String("license")) {
+        updateSupportInfoAsync();
+    }
+    else if (type == QLatin1String("profile")) {
+        if (m_authorized || isEnterprise()) {
+            updateUserInfoAsync();
+        }
+    }
+}
+
+void NGAccess::onLicenseChanged()
+{
+    // License is read by setClientId on start
+    if(m_configDir.isEmpty()) {
+        return;
+    }
+    if(m_authorized || isEnterprise()) {
+        updateUserInfoAsync();
+        updateSupportInfoAsync();
+    }
 }
 
 void NGAccess::logMessage(const QString &value, LogLevel level)
@@ -29,6 +29,11 @@
 #include <QObject>
 #include <QTimer>
 
+class NGAccessSettings;
+class NGEventChannel;
+class NGLicenseState;
+class NGSignVerifier;
+
 class SignInEvent : public QObject
 {
     Q_OBJECT
@@ -57,8 +62,14 @@ public:
     bool isUserAuthorized() const;
     bool isEnterprise() const;
     bool isEndpointAvailable() const;
+    bool isReady() const;
+    QVariantMap startupTimings() const;
 
     QString getPluginSign(const QString &app, const QString &plugin) const;
+    QMap<QString, QString> getPluginSigns(const QMap<QString, QString> &plugins) const;
+    QFuture<QMap<QString, QString> > getPluginSignsAsync(const QMap<QString, QString> &plugins) const;
+    QFuture<void> updateUserInfoAsync();
+    QFuture<void> updateSupportInfoAsync();
 
     void setScope(const QString &scope);
     void setClientId(const QString &clientId);
@@ -68,10 +79,13 @@ public:
     void setUserInfoEndpoint(const QString &endpoint);
     void setUseCodeChallenge(bool val);
     void setCheckEndpointTimeout(int);
+    void setEventEndpoint(const QString &endpoint);
     QString endPoint() const;
     QString authEndpoint() const;
     QString tokenEndpoint() const;
     QString userInfoEndpoint() const;
+    QString eventEndpoint() const;
+    bool isEventChannelConnected() const;
     bool useCodeChallenge() const;
     bool checkEndpoint(const QString &endpoint = QString());
     enum AuthSourceType authType() const;
@@ -96,14 +110,17 @@ signals:
     void userInfoUpdated();
     void supportInfoUpdated();
     void endpointAvailableUpdated();
+    void ready();
 
 private slots:
-    void onUserInfoUpdated();
-    void onSupportInfoUpdated();
+    void onEventChannelConnected();
+    void onEventChannelDisconnected();
+    void onEvent(const QString &type, const QByteArray &data);
+    void onLicenseChanged();
 
 protected:
     NGAccess();
-    virtual ~NGAccess() = default;
+    virtual ~NGAccess();
     NGAccess(const NGAccess &) = delete;
     NGAccess &operator= (const NGAccess &) = delete;
 
@@ -112,8 +129,9 @@ protected:
                             unsigned char *signature, unsigned int sigLength,
                             QString &errorMsg) const;
     void getTokens(const QString &code, const QString &redirectUri, const QString &verifier);
-    void updateUserInfo() const;
-    void updateSupportInfo() const;
+    void onUserInfoUpdated();
+    void onSupportInfoUpdated();
+    void warmUp();
     QString getPublicKey() const;
     QString pluginSign(const QString &pluginName, const QString &pluginVersion) const;
 
@@ -122,18 +140,26 @@ private:
     bool m_supported;
     bool m_endpointAvailable;
     QTimer m_checkTimer;
+    int m_checkTimeout;
+    NGEventChannel *m_eventChannel;
+    NGAccessSettings *m_settings;
+    NGSignVerifier *m_signVerifier;
+    NGLicenseState *m_license;
     QString m_clientId, m_scope, m_endpoint, m_authEndpoint, m_logoutEndpoint, m_tokenEndpoint, m_userInfoEndpoint;
     SignInEvent *m_signInEvent;
     AuthSourceType m_authType;
     QIcon m_avatar;
     QString m_configDir;
-    QFutureWatcher<void> *m_updateUserInfoWatcher, *m_updateSupportInfoWatcher;
     QFutureWatcher<bool> *m_updateCheckEndpointWatcher;
     QString m_firstName, m_lastName, m_userId, m_email;
     mutable QString m_updateToken;
     QString m_licenseDir;
     QStringList m_roles;
     bool m_codeChallenge;
+    bool m_ready;
+    quint64 m_warmUpGeneration;
+    QFuture<QVariantMap> m_warmUpFuture;
+    QVariantMap m_startupTimings;
 };
 
 #endif // NGFRAMEWORK_ACCESS_H
@@ -0,0 +1,187 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Framework library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#include "accesssettings.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+#include <QSettings>
+
+constexpr int defaultFlushDelay = 500;
+
+NGAccessSettings::NGAccessSettings(QObject *parent) :
+    QObject(parent),
+    m_dirty(false),
+    m_flushScheduled(false)
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(defaultFlushDelay);
+    connect(&m_flushTimer, SIGNAL(timeout()), this, SLOT(sync()));
+    if(QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), this,
+                SLOT(sync()));
+    }
+}
+
+NGAccessSettings::~NGAccessSettings()
+{
+    sync();
+}
+
+/**
+ * @brief Read settings file. Not saved changes of previous file are written
+ * before.
+ * @param path Settings file path.
+ */
+void NGAccessSettings::load(const QString &path)
+{
+    sync();
+
+    QVariantMap values;
+    QSettings settings(path, QSettings::IniFormat);
+    for(const QString &key : settings.allKeys()) {
+        values[key] = settings.value(key);
+    }
+
+    QWriteLocker locker(&m_lock);
+    m_path = path;
+    m_values = values;
+}
+
+QString NGAccessSettings::path() const
+{
+    QReadLocker locker(&m_lock);
+    return m_path;
+}
+
+QVariant NGAccessSettings::value(const QString &key,
+                                 const QVariant &defaultValue) const
+{
+    QReadLocker locker(&m_lock);
+    return m_values.value(key, defaultValue);
+}
+
+void NGAccessSettings::setValue(const QString &key, const QVariant &value)
+{
+    {
+        QWriteLocker locker(&m_lock);
+        m_values[key] = value;
+    }
+    markDirty();
+}
+
+/**
+ * @brief Set several values at once. Other threads see either all or none of
+ * them.
+ */
+void NGAccessSettings::setValues(const QVariantMap &values)
+{
+    {
+        QWriteLocker locker(&m_lock);
+        for(auto it = values.constBegin(); it != values.constEnd(); ++it) {
+            m_values[it.key()] = it.value();
+        }
+    }
+    markDirty();
+}
+
+/**
+ * @brief Set delay between the first change and file write. Default is 500 ms.
+ */
+void NGAccessSettings::setFlushDelay(int msec)
+{
+    m_flushTimer.setInterval(msec);
+}
+
+/**
+ * @brief Write changes to disk now. Settings are written to temporary file
+ * and then the file is renamed over settings file.
+ * @return true if there were nothing to write or write succeeded.
+ */
+bool NGAccessSettings::sync()
+{
+    if(!m_dirty.exchange(false)) {
+        return true;
+    }
+
+    QString path;
+    QVariantMap values;
+    {
+        QReadLocker locker(&m_lock);
+        path = m_path;
+        values = m_values;
+    }
+    if(path.isEmpty()) {
+        return true;
+    }
+
+    // QSettings writes INI format, QSaveFile replaces the file atomically
+    QString tmpPath = path + QLatin1String(".ini.tmp");
+    QByteArray data;
+    {
+        QSettings settings(tmpPath, QSettings::IniFormat);
+        settings.clear();
+        for(auto it = values.constBegin(); it != values.constEnd(); ++it) {
+            settings.setValue(it.key(), it.value());
+        }
+        settings.sync();
+        if(settings.status() != QSettings::NoError) {
+            qDebug() << "Failed to write settings" << tmpPath;
+        }
+    }
+    QFile tmp(tmpPath);
+    if(tmp.open(QIODevice::ReadOnly)) {
+        data = tmp.readAll();
+        tmp.close();
+    }
+    tmp.remove();
+
+    if(data.isEmpty() && !values.isEmpty()) {
+        m_dirty = true;
+        return false;
+    }
+
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() ||
+            !file.commit()) {
+        qDebug() << "Failed to save settings" << path << file.errorString();
+        m_dirty = true;
+        return false;
+    }
+    return true;
+}
+
+void NGAccessSettings::scheduleFlush()
+{
+    m_flushScheduled = false;
+    if(!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+void NGAccessSettings::markDirty()
+{
+    m_dirty = true;
+    // Timer belongs to owner thread, start it there
+    if(!m_flushScheduled.exchange(true)) {
+        QMetaObject::invokeMethod(this, "scheduleFlush", Qt::QueuedConnection);
+    }
+}
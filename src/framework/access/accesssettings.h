@@ -0,0 +1,70 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Framework library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGFRAMEWORK_ACCESSSETTINGS_H
+#define NGFRAMEWORK_ACCESSSETTINGS_H
+
+#include <QObject>
+#include <QReadWriteLock>
+#include <QTimer>
+#include <QVariant>
+
+#include <atomic>
+
+/**
+ * @brief The NGAccessSettings class is in-memory copy of access settings.ini.
+ * File is read once on load, values are read and written from any thread.
+ * Changes are written to disk in the owner thread after short delay, several
+ * changes are combined into one write. File is replaced atomically, so
+ * readers never see partly written settings.
+ */
+class Q_DECL_HIDDEN NGAccessSettings : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NGAccessSettings(QObject *parent = nullptr);
+    virtual ~NGAccessSettings() override;
+
+    void load(const QString &path);
+    QString path() const;
+    QVariant value(const QString &key,
+                   const QVariant &defaultValue = QVariant()) const;
+    void setValue(const QString &key, const QVariant &value);
+    void setValues(const QVariantMap &values);
+    void setFlushDelay(int msec);
+
+public slots:
+    bool sync();
+
+private slots:
+    void scheduleFlush();
+
+private:
+    void markDirty();
+
+private:
+    mutable QReadWriteLock m_lock;
+    QString m_path;
+    QVariantMap m_values;
+    QTimer m_flushTimer;
+    std::atomic<bool> m_dirty;
+    std::atomic<bool> m_flushScheduled;
+};
+
+#endif // NGFRAMEWORK_ACCESSSETTINGS_H
@@ -0,0 +1,338 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Framework library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#include "eventchannel.h"
+
+#include <QDebug>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+#include "async.h"
+#include "executor.h"
+#include "request.h"
+
+constexpr int initialRetryDelay = 1000;
+constexpr int maxRetryDelay = 300000;
+constexpr int defaultIdleTimeout = 90000;
+
+// Answers which will not change on retry: client errors other than timeout and
+// rate limit, 204 (the SSE way to ask a client to stop reconnecting) and
+// success responses which are not event streams.
+static bool isUnsupported(QNetworkReply *reply)
+{
+    int status = reply->attribute(
+                QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if(status == 204) {
+        return true;
+    }
+    if(status >= 200 && status < 300) {
+        QByteArray contentType = reply->header(
+                    QNetworkRequest::ContentTypeHeader).toByteArray();
+        return !contentType.startsWith("text/event-stream");
+    }
+    return status >= 400 && status < 500 && status != 408 && status != 429;
+}
+
+static bool isAuthFailure(QNetworkReply *reply)
+{
+    int status = reply->attribute(
+                QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    return status == 401 || status == 403;
+}
+
+NGEventChannel::NGEventChannel(QObject *parent) :
+    QObject(parent),
+    m_manager(new QNetworkAccessManager(this)),
+    m_retryDelay(initialRetryDelay),
+    m_serverRetry(0),
+    m_session(0),
+    m_connected(false),
+    m_opened(false),
+    m_connecting(false)
+{
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(defaultIdleTimeout);
+    connect(&m_idleTimer, SIGNAL(timeout()), this, SLOT(onIdle()));
+    m_reconnectTimer.setSingleShot(true);
+    connect(&m_reconnectTimer, SIGNAL(timeout()), this, SLOT(connectToServer()));
+}
+
+NGEventChannel::~NGEventChannel()
+{
+    m_opened = false;
+    if(m_reply) {
+        m_reply->disconnect(this);
+        m_reply->abort();
+    }
+}
+
+/**
+ * @brief Connect to event stream. Previous connection is closed.
+ * @param url Event stream URL. Authorization header is taken from NGRequest.
+ */
+void NGEventChannel::open(const QUrl &url)
+{
+    close();
+    m_url = url;
+    m_opened = true;
+    m_retryDelay = initialRetryDelay;
+    m_serverRetry = 0;
+    m_lastEventId.clear();
+    connectToServer();
+}
+
+void NGEventChannel::close()
+{
+    m_opened = false;
+    m_connecting = false;
+    m_session++;
+    m_reconnectTimer.stop();
+    if(m_reply) {
+        m_reply->abort();
+    }
+}
+
+bool NGEventChannel::isConnected() const
+{
+    return m_connected;
+}
+
+QUrl NGEventChannel::url() const
+{
+    return m_url;
+}
+
+/**
+ * @brief Set time without any data after which connection is restarted.
+ * Server should send comments as heartbeats more often.
+ * @param msec Timeout in milliseconds.
+ */
+void NGEventChannel::setIdleTimeout(int msec)
+{
+    m_idleTimer.setInterval(msec);
+}
+
+void NGEventChannel::connectToServer()
+{
+    if(!m_opened || m_reply || m_connecting) {
+        return;
+    }
+
+    // Header may need token refresh, which is a blocking request
+    m_connecting = true;
+    quint64 session = m_session;
+    QString url = m_url.toString();
+    QFuture<QString> future = NGIOExecutor::instance().run([url]() {
+        return NGRequest::getAuthHeader(url);
+    });
+    ngThen(future, this, [this, session](QFuture<QString> result) {
+        if(session != m_session) {
+            return; // Closed or opened again meanwhile
+        }
+        m_connecting = false;
+        startRequest(result.result());
+    });
+}
+
+void NGEventChannel::startRequest(const QString &auth)
+{
+    if(!m_opened || m_reply) {
+        return;
+    }
+
+    QNetworkRequest request(m_url);
+    request.setRawHeader("Accept", "text/event-stream");
+    request.setRawHeader("Cache-Control", "no-cache");
+    if(!m_lastEventId.isEmpty()) {
+        request.setRawHeader("Last-Event-ID", m_lastEventId);
+    }
+    // Header is "Authorization: Bearer ..."
+    int pos = auth.indexOf(QLatin1String(": "));
+    if(pos > 0) {
+        request.setRawHeader(auth.left(pos).toLatin1(),
+                             auth.mid(pos + 2).toLatin1());
+    }
+
+    m_reply = m_manager->get(request);
+    connect(m_reply, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(m_reply, SIGNAL(finished()), this, SLOT(onFinished()));
+    m_idleTimer.start();
+}
+
+void NGEventChannel::onReadyRead()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    if(reply == nullptr || reply != m_reply) {
+        return;
+    }
+
+    if(!m_connected) {
+        int status = reply->attribute(
+                    QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        QByteArray contentType = reply->header(
+                    QNetworkRequest::ContentTypeHeader).toByteArray();
+        if(status != 200 || !contentType.startsWith("text/event-stream")) {
+            // onFinished decides whether to retry
+            reply->abort();
+            return;
+        }
+        m_retryDelay = initialRetryDelay;
+        setConnected(true);
+    }
+
+    m_idleTimer.start();
+    m_buffer.append(reply->readAll());
+
+    int start = 0;
+    for(int i = 0; i < m_buffer.size(); ++i) {
+        char c = m_buffer.at(i);
+        if(c != '\n' && c != '\r') {
+            continue;
+        }
+        // CR LF pair is one line end, wait for LF if CR is the last byte
+        if(c == '\r' && i + 1 == m_buffer.size()) {
+            break;
+        }
+        parseLine(m_buffer.mid(start, i - start));
+        if(c == '\r' && m_buffer.at(i + 1) == '\n') {
+            ++i;
+        }
+        start = i + 1;
+    }
+    m_buffer.remove(0, start);
+}
+
+void NGEventChannel::parseLine(const QByteArray &line)
+{
+    if(line.isEmpty()) {
+        dispatch();
+        return;
+    }
+    if(line.startsWith(':')) {
+        return; // Comment, used as heartbeat
+    }
+
+    int colon = line.indexOf(':');
+    QByteArray field = colon < 0 ? line : line.left(colon);
+    QByteArray value;
+    if(colon >= 0) {
+        value = line.mid(colon + 1);
+        if(value.startsWith(' ')) {
+            value.remove(0, 1);
+        }
+    }
+
+    if(field == "event") {
+        m_eventType = value;
+    }
+    else if(field == "data") {
+        m_eventData.append(value).append('\n');
+    }
+    else if(field == "id") {
+        m_lastEventId = value;
+    }
+    else if(field == "retry") {
+        bool ok;
+        int retry = value.toInt(&ok);
+        if(ok && retry >= 0) {
+            m_serverRetry = retry;
+        }
+    }
+}
+
+void NGEventChannel::dispatch()
+{
+    if(!m_eventData.isEmpty()) {
+        m_eventData.chop(1); // Last line end
+        QString type = m_eventType.isEmpty() ? QLatin1String("message") :
+                                               QString::fromUtf8(m_eventType);
+        emit eventReceived(type, m_eventData);
+    }
+    m_eventType.clear();
+    m_eventData.clear();
+}
+
+void NGEventChannel::onFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    if(reply == nullptr) {
+        return;
+    }
+    reply->deleteLater();
+    if(reply != m_reply) {
+        return;
+    }
+
+    bool wasConnected = m_connected;
+    m_reply = nullptr;
+    m_idleTimer.stop();
+    m_buffer.clear();
+    m_eventType.clear();
+    m_eventData.clear();
+    setConnected(false);
+
+    if(!wasConnected) {
+        // Auth may change with token refresh or next sign in, retry seldom.
+        // Other permanent answers stop the channel until next open(), polling
+        // stays in use.
+        if(isAuthFailure(reply)) {
+            m_retryDelay = maxRetryDelay;
+        }
+        else if(isUnsupported(reply)) {
+            qDebug() << "Event channel is not supported by server" << m_url
+                     << reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt()
+                     << reply->header(QNetworkRequest::ContentTypeHeader).toByteArray();
+            m_opened = false;
+            return;
+        }
+    }
+    scheduleReconnect();
+}
+
+void NGEventChannel::onIdle()
+{
+    if(m_reply) {
+        qDebug() << "Event channel is idle, reconnect" << m_url;
+        m_reply->abort();
+    }
+}
+
+void NGEventChannel::scheduleReconnect()
+{
+    if(!m_opened) {
+        return;
+    }
+    m_reconnectTimer.start(qMax(m_serverRetry, m_retryDelay));
+    m_retryDelay = qMin(m_retryDelay * 2, maxRetryDelay);
+}
+
+void NGEventChannel::setConnected(bool connected)
+{
+    if(m_connected == connected) {
+        return;
+    }
+    m_connected = connected;
+    if(connected) {
+        emit this->connected();
+    }
+    else {
+        emit disconnected();
+    }
+}
@@ -0,0 +1,90 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Framework library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGFRAMEWORK_EVENTCHANNEL_H
+#define NGFRAMEWORK_EVENTCHANNEL_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QUrl>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+/**
+ * @brief The NGEventChannel class is a Server-Sent Events (text/event-stream)
+ * client. Connection is kept open and restored with growing delay after
+ * failures, the last event id is sent on reconnect. Channel is considered
+ * lost if nothing (including comments used as heartbeats) is received for
+ * idle timeout. Channel stops reconnecting if server answers with client error,
+ * 204 or not an event stream, authorization errors are retried with maximum
+ * delay.
+ */
+class Q_DECL_HIDDEN NGEventChannel : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NGEventChannel(QObject *parent = nullptr);
+    virtual ~NGEventChannel();
+
+    void open(const QUrl &url);
+    void close();
+    bool isConnected() const;
+    QUrl url() const;
+    void setIdleTimeout(int msec);
+
+signals:
+    void connected();
+    void disconnected();
+    void eventReceived(const QString &type, const QByteArray &data);
+
+private slots:
+    void onReadyRead();
+    void onFinished();
+    void onIdle();
+    void connectToServer();
+
+private:
+    void startRequest(const QString &auth);
+    void parseLine(const QByteArray &line);
+    void dispatch();
+    void scheduleReconnect();
+    void setConnected(bool connected);
+
+private:
+    QNetworkAccessManager *m_manager;
+    QPointer<QNetworkReply> m_reply;
+    QUrl m_url;
+    QTimer m_idleTimer;
+    QTimer m_reconnectTimer;
+    QByteArray m_buffer;
+    QByteArray m_eventType;
+    QByteArray m_eventData;
+    QByteArray m_lastEventId;
+    int m_retryDelay;
+    int m_serverRetry;
+    quint64 m_session;
+    bool m_connected;
+    bool m_opened;
+    bool m_connecting;
+};
+
+#endif // NGFRAMEWORK_EVENTCHANNEL_H
@@ -0,0 +1,181 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Framework library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#include "licensestate.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+
+#include "core.h"
+
+constexpr const char *licenseFile = "license.json";
+
+NGLicenseState::NGLicenseState(QObject *parent) :
+    QObject(parent),
+    m_watcher(new QFileSystemWatcher(this)),
+    m_generation(0)
+{
+    connect(m_watcher, SIGNAL(directoryChanged(QString)), this,
+            SLOT(refresh()));
+    connect(m_watcher, SIGNAL(fileChanged(QString)), this, SLOT(refresh()));
+}
+
+/**
+ * @brief Set license directory and start watching it.
+ * @param path License directory path.
+ */
+void NGLicenseState::setPath(const QString &path)
+{
+    if(!m_watcher->files().isEmpty()) {
+        m_watcher->removePaths(m_watcher->files());
+    }
+    if(!m_watcher->directories().isEmpty()) {
+        m_watcher->removePaths(m_watcher->directories());
+    }
+    {
+        QWriteLocker locker(&m_lock);
+        m_path = path;
+        m_values.clear();
+        m_generation++;
+    }
+    refresh();
+}
+
+QString NGLicenseState::path() const
+{
+    QReadLocker locker(&m_lock);
+    return m_path;
+}
+
+QString NGLicenseState::filePath(const QString &name) const
+{
+    return QDir(path()).filePath(name);
+}
+
+/**
+ * @brief Enterprise license is installed if license directory has
+ * license.json file.
+ */
+bool NGLicenseState::isEnterprise() const
+{
+    return hasFile(QLatin1String(licenseFile));
+}
+
+bool NGLicenseState::hasFile(const QString &name) const
+{
+    QReadLocker locker(&m_lock);
+    return m_files.contains(name);
+}
+
+/**
+ * @brief Values from license.json. File is parsed once per keys list until
+ * it changes.
+ * @param keys Keys to read.
+ * @return Map of key and value or empty map if there is no license.
+ */
+QMap<QString, QVariant> NGLicenseState::values(const QStringList &keys) const
+{
+    QString cacheKey = keys.join(QLatin1Char('\n'));
+    QString path;
+    quint64 generation;
+    {
+        QReadLocker locker(&m_lock);
+        if(!m_files.contains(QLatin1String(licenseFile))) {
+            return QMap<QString, QVariant>();
+        }
+        auto it = m_values.constFind(cacheKey);
+        if(it != m_values.constEnd()) {
+            return it.value();
+        }
+        path = QDir(m_path).filePath(QLatin1String(licenseFile));
+        generation = m_generation;
+    }
+
+    QMap<QString, QVariant> out = jsonToMap(path, keys);
+    QWriteLocker locker(&m_lock);
+    // Do not cache values of file changed while parsing
+    if(generation == m_generation) {
+        m_values.insert(cacheKey, out);
+    }
+    return out;
+}
+
+/**
+ * @brief Watch license directory or, while it does not exist, its nearest
+ * existing parent, so license installed later is noticed.
+ */
+void NGLicenseState::watchDirectory(const QString &path)
+{
+    QString dir = QDir::cleanPath(path);
+    while(!dir.isEmpty() && !QFileInfo(dir).isDir()) {
+        QString parent = QFileInfo(dir).absolutePath();
+        if(parent == dir) {
+            break;
+        }
+        dir = parent;
+    }
+
+    QStringList watched = m_watcher->directories();
+    if(watched.size() == 1 && watched.first() == dir) {
+        return;
+    }
+    if(!watched.isEmpty()) {
+        m_watcher->removePaths(watched);
+    }
+    if(!dir.isEmpty() && QFileInfo(dir).isDir()) {
+        m_watcher->addPath(dir);
+    }
+}
+
+void NGLicenseState::refresh()
+{
+    QString path = this->path();
+    if(!path.isEmpty()) {
+        watchDirectory(path);
+    }
+
+    QSet<QString> files;
+    QDir dir(path);
+    if(!path.isEmpty() && dir.exists()) {
+        for(const QString &name : dir.entryList(QDir::Files)) {
+            files.insert(name);
+        }
+    }
+
+    // Files replaced by rename drop out of watcher, add them again
+    QString licensePath = dir.filePath(QLatin1String(licenseFile));
+    if(files.contains(QLatin1String(licenseFile)) &&
+            !m_watcher->files().contains(licensePath)) {
+        m_watcher->addPath(licensePath);
+    }
+
+    QDateTime modified = QFileInfo(licensePath).lastModified();
+    {
+        QWriteLocker locker(&m_lock);
+        if(files == m_files && modified == m_modified) {
+            return;
+        }
+        m_files = files;
+        m_modified = modified;
+        m_values.clear();
+        m_generation++;
+    }
+    emit changed();
+}
@@ -0,0 +1,71 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Framework library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGFRAMEWORK_LICENSESTATE_H
+#define NGFRAMEWORK_LICENSESTATE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QStringList>
+#include <QVariant>
+
+class QFileSystemWatcher;
+
+/**
+ * @brief The NGLicenseState class keeps state of enterprise license directory
+ * in memory. Directory content is listed and license.json is parsed once after
+ * each change reported by QFileSystemWatcher, not on every query. Methods
+ * except setPath are thread safe.
+ */
+class Q_DECL_HIDDEN NGLicenseState : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NGLicenseState(QObject *parent = nullptr);
+
+    void setPath(const QString &path);
+    QString path() const;
+    QString filePath(const QString &name) const;
+    bool isEnterprise() const;
+    bool hasFile(const QString &name) const;
+    QMap<QString, QVariant> values(const QStringList &keys) const;
+
+signals:
+    void changed();
+
+private slots:
+    void refresh();
+
+private:
+    void watchDirectory(const QString &path);
+
+private:
+    QFileSystemWatcher *m_watcher;
+    mutable QReadWriteLock m_lock;
+    QString m_path;
+    QSet<QString> m_files;
+    QDateTime m_modified;
+    quint64 m_generation;
+    mutable QHash<QString, QMap<QString, QVariant> > m_values;
+};
+
+#endif // NGFRAMEWORK_LICENSESTATE_H
@@ -37,6 +37,7 @@
 #include <sstream>
 
 #include "core/core.h"
+#include "core/cplbridge.h"
 
 #include "logger.h"
 
@@ -92,7 +93,8 @@ static QString sha256(const QString &code) {
     unsigned char hash[SHA256_DIGEST_LENGTH];
     SHA256_CTX sha256;
     SHA256_Init(&sha256);
-    SHA256_Update(&sha256, code.toStdString().c_str(), code.size());
+    Utf8 codeUtf8(code);
+    SHA256_Update(&sha256, codeUtf8.data(), static_cast<size_t>(codeUtf8.size()));
     SHA256_Final(hash, &sha256);
     return toBase64(hash, SHA256_DIGEST_LENGTH);
     //return QString::fromStdString(toHex(hash, SHA256_DIGEST_LENGTH));
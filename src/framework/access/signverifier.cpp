@@ -0,0 +1,204 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Framework library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#include "signverifier.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QThreadStorage>
+
+#include <openssl/bio.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+
+constexpr int maxCachedResults = 256;
+
+namespace {
+struct DigestContext {
+    DigestContext() : ctx(EVP_MD_CTX_create()) {}
+    ~DigestContext() { EVP_MD_CTX_destroy(ctx); }
+    EVP_MD_CTX *ctx;
+};
+}
+
+static QThreadStorage<DigestContext*> gDigestContext;
+
+static EVP_MD_CTX *threadDigestContext()
+{
+    if(!gDigestContext.hasLocalData()) {
+        gDigestContext.setLocalData(new DigestContext);
+    }
+    return gDigestContext.localData()->ctx;
+}
+
+NGSignVerifier::NGSignVerifier() :
+    m_size(-1)
+{
+}
+
+/**
+ * @brief Verify RSA SHA256 signature.
+ * @param keyPath Path to PEM public key file.
+ * @param message Signed message.
+ * @param signature Binary signature.
+ * @param errorMsg Error description if verification failed.
+ * @return true if signature is valid.
+ */
+bool NGSignVerifier::verify(const QString &keyPath, const QByteArray &message,
+                            const QByteArray &signature, QString &errorMsg)
+{
+    std::shared_ptr<EVP_PKEY> pubkey = key(keyPath, errorMsg);
+    if(!pubkey) {
+        return false;
+    }
+
+    // Separate digests, so bytes moved from message to signature give other
+    // key
+    QByteArray digest =
+            QCryptographicHash::hash(message, QCryptographicHash::Sha256) +
+            QCryptographicHash::hash(signature, QCryptographicHash::Sha256);
+
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_results.constFind(digest);
+        if(it != m_results.constEnd()) {
+            return it.value();
+        }
+    }
+
+    EVP_MD_CTX *ctx = threadDigestContext();
+    if(!ctx) {
+        qWarning() << "Failed EVP_MD_CTX_create";
+        errorMsg = "Failed EVP_MD_CTX_create";
+        return false;
+    }
+
+    if(!EVP_VerifyInit(ctx, EVP_sha256())) {
+        qWarning() << "Failed EVP_VerifyInit";
+        errorMsg = "Failed EVP_VerifyInit";
+        return false;
+    }
+
+    if(!EVP_VerifyUpdate(ctx, message.constData(),
+                         static_cast<size_t>(message.size()))) {
+        qWarning() << "Failed EVP_VerifyUpdate";
+        errorMsg = "Failed EVP_VerifyUpdate";
+        return false;
+    }
+
+    int result = EVP_VerifyFinal(ctx,
+        reinterpret_cast<const unsigned char*>(signature.constData()),
+        static_cast<unsigned int>(signature.size()), pubkey.get());
+
+    qDebug() << "Signature is " << (result == 1 ? "valid" : "invalid");
+
+    // Errors (-1) are not remembered, next call tries again
+    if(result >= 0) {
+        QMutexLocker locker(&m_mutex);
+        if(pubkey == m_key) {
+            if(m_results.size() >= maxCachedResults) {
+                m_results.clear();
+            }
+            m_results.insert(digest, result == 1);
+        }
+    }
+    return result == 1;
+}
+
+/**
+ * @brief Public key file content.
+ * @param keyPath Path to PEM public key file.
+ * @return Key text or empty string if file is not readable.
+ */
+QString NGSignVerifier::publicKey(const QString &keyPath)
+{
+    QMutexLocker locker(&m_mutex);
+    refresh(keyPath);
+    return QString::fromUtf8(m_pem);
+}
+
+void NGSignVerifier::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_path.clear();
+    m_modified = QDateTime();
+    m_size = -1;
+    m_pem.clear();
+    m_key.reset();
+    m_results.clear();
+}
+
+std::shared_ptr<EVP_PKEY> NGSignVerifier::key(const QString &keyPath,
+                                              QString &errorMsg)
+{
+    QMutexLocker locker(&m_mutex);
+    if(!refresh(keyPath)) {
+        qWarning() << QString("Failed open file %1").arg(keyPath);
+        errorMsg = QString("Failed open file %1").arg(keyPath);
+        return std::shared_ptr<EVP_PKEY>();
+    }
+    if(m_key) {
+        return m_key;
+    }
+
+    BIO *bio = BIO_new_mem_buf(m_pem.constData(), m_pem.size());
+    EVP_PKEY *pubkey = bio ? PEM_read_bio_PUBKEY(bio, nullptr, nullptr, nullptr) :
+                             nullptr;
+    BIO_free(bio);
+    if(!pubkey) {
+        qWarning() << "Failed PEM_read_PUBKEY";
+        errorMsg = "Failed PEM_read_PUBKEY";
+        return std::shared_ptr<EVP_PKEY>();
+    }
+    m_key = std::shared_ptr<EVP_PKEY>(pubkey, EVP_PKEY_free);
+    return m_key;
+}
+
+// Must be called with locked mutex. Reread key file if it was changed.
+bool NGSignVerifier::refresh(const QString &keyPath)
+{
+    QFileInfo info(keyPath);
+    if(!info.exists() || !info.isFile()) {
+        m_path.clear();
+        m_pem.clear();
+        m_key.reset();
+        m_results.clear();
+        return false;
+    }
+
+    if(keyPath == m_path && info.lastModified() == m_modified &&
+            info.size() == m_size) {
+        return true;
+    }
+
+    QFile file(keyPath);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    m_pem = file.readAll();
+    m_path = keyPath;
+    m_modified = info.lastModified();
+    m_size = info.size();
+    m_key.reset();
+    m_results.clear();
+    return true;
+}
@@ -0,0 +1,65 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Framework library
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#ifndef NGFRAMEWORK_SIGNVERIFIER_H
+#define NGFRAMEWORK_SIGNVERIFIER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include <memory>
+
+typedef struct evp_pkey_st EVP_PKEY;
+
+/**
+ * @brief The NGSignVerifier class checks RSA SHA256 signatures with public key
+ * from PEM file. Parsed key is kept until file modification time or size
+ * changes. Digest context is created once per thread. Results are remembered
+ * by SHA256 of message followed by SHA256 of signature, so repeated checks do
+ * not call OpenSSL.
+ * Methods are thread safe.
+ */
+class Q_DECL_HIDDEN NGSignVerifier
+{
+public:
+    NGSignVerifier();
+
+    bool verify(const QString &keyPath, const QByteArray &message,
+                const QByteArray &signature, QString &errorMsg);
+    QString publicKey(const QString &keyPath);
+    void clear();
+
+private:
+    std::shared_ptr<EVP_PKEY> key(const QString &keyPath, QString &errorMsg);
+    bool refresh(const QString &keyPath);
+
+private:
+    QMutex m_mutex;
+    QString m_path;
+    QDateTime m_modified;
+    qint64 m_size;
+    QByteArray m_pem;
+    std::shared_ptr<EVP_PKEY> m_key;
+    QHash<QByteArray, bool> m_results;
+};
+
+#endif // NGFRAMEWORK_SIGNVERIFIER_H
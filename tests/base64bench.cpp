@@ -0,0 +1,148 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library tests
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/core.h"
+
+#include <QtTest>
+
+#include "cpl_conv.h"
+#include "cpl_string.h"
+
+// fromBase64/toBase64 as they were implemented over CPL
+static QString fromBase64CPL(const QString &str)
+{
+    QString cpy(str);
+    cpy = cpy.replace("-", "+").replace("_", "/");
+    GByte *base64 = reinterpret_cast<GByte*>(CPLStrdup(cpy.toStdString().c_str()));
+    int length = CPLBase64DecodeInPlace(base64);
+    std::string out(reinterpret_cast<const char*>(base64), length);
+    CPLFree(base64);
+    return QString::fromStdString(out);
+}
+
+static QString toBase64CPL(unsigned char *data, int size)
+{
+    char* base64new = CPLBase64Encode(size, data);
+    QString out(base64new);
+    CPLFree(base64new);
+    out = out.replace("+", "-").replace("/", "_").replace("=", "");
+    return out;
+}
+
+// Payload is ASCII, so decoded text compares equal for both implementations
+static QByteArray payload(int size)
+{
+    QByteArray out;
+    out.reserve(size);
+    const char *sample = "{\"sub\":\"4f1c7a\",\"aud\":\"ngstd\",\"exp\":1700000000,"
+                         "\"resource_access\":{\"ngid\":{\"roles\":[\"user\"]}}}";
+    while(out.size() < size) {
+        out.append(sample);
+    }
+    out.resize(size);
+    return out;
+}
+
+class Base64Bench : public QObject
+{
+    Q_OBJECT
+private slots:
+    void lenient();
+    void decode_data();
+    void decode();
+    void encode_data();
+    void encode();
+};
+
+void Base64Bench::lenient()
+{
+    QString text("SGVs\nbG8g\r\nV29y bGQ=");
+    QCOMPARE(fromBase64(text), QString("Hello World"));
+    QCOMPARE(fromBase64(text), fromBase64CPL(text));
+    QVERIFY(fromBase64Url(text.toLatin1()).isEmpty());
+    QCOMPARE(fromBase64Url("SGVsbG8gV29ybGQ"), QByteArray("Hello World"));
+}
+
+// Rows are JWT sized token and big payload for each implementation. Sizes are
+// multiples of 3: CPL decoder appends garbage bytes to unpadded tails.
+void Base64Bench::decode_data()
+{
+    QTest::addColumn<bool>("native");
+    QTest::addColumn<int>("size");
+    for(int size : {600, 1048575}) {
+        QTest::newRow(qPrintable(QString("cpl %1").arg(size))) << false << size;
+        QTest::newRow(qPrintable(QString("native %1").arg(size))) << true << size;
+    }
+}
+
+void Base64Bench::decode()
+{
+    QFETCH(bool, native);
+    QFETCH(int, size);
+    QByteArray data = payload(size);
+    QString encoded = QString::fromLatin1(data.toBase64(
+            QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+    QString expected = QString::fromLatin1(data);
+
+    QString out;
+    if(native) {
+        QBENCHMARK {
+            out = fromBase64(encoded);
+        }
+    }
+    else {
+        QBENCHMARK {
+            out = fromBase64CPL(encoded);
+        }
+    }
+    QCOMPARE(out, expected);
+}
+
+void Base64Bench::encode_data()
+{
+    decode_data();
+}
+
+void Base64Bench::encode()
+{
+    QFETCH(bool, native);
+    QFETCH(int, size);
+    QByteArray data = payload(size);
+    unsigned char *bytes = reinterpret_cast<unsigned char*>(data.data());
+    QString expected = QString::fromLatin1(data.toBase64(
+            QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+
+    QString out;
+    if(native) {
+        QBENCHMARK {
+            out = toBase64(bytes, size);
+        }
+    }
+    else {
+        QBENCHMARK {
+            out = toBase64CPL(bytes, size);
+        }
+    }
+    QCOMPARE(out, expected);
+}
+
+QTEST_APPLESS_MAIN(Base64Bench)
+
+#include "base64bench.moc"
@@ -0,0 +1,202 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Framework Library tests
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include "access/eventchannel.h"
+
+#include <QLoggingCategory>
+#include <QNetworkProxy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtTest>
+
+// Minimal HTTP server: records request headers of every connection and answers
+// with prepared response. Event stream connections are kept open.
+class EventServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit EventServer(const QByteArray &response) : m_response(response)
+    {
+        connect(&m_server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+        m_server.listen(QHostAddress::LocalHost);
+    }
+
+    QUrl url() const
+    {
+        return QUrl(QString("http://127.0.0.1:%1/events").arg(m_server.serverPort()));
+    }
+
+    QTcpSocket *socket() const { return m_socket; }
+    QList<QByteArray> requests() const { return m_requests; }
+
+private slots:
+    void onNewConnection()
+    {
+        m_socket = m_server.nextPendingConnection();
+        connect(m_socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    }
+
+    void onReadyRead()
+    {
+        QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+        QByteArray &request = m_pending[socket];
+        request.append(socket->readAll());
+        if(!request.contains("\r\n\r\n")) {
+            return;
+        }
+        m_requests.append(request);
+        m_pending.remove(socket);
+        socket->write(m_response);
+        if(!m_response.contains("text/event-stream")) {
+            socket->disconnectFromHost();
+        }
+    }
+
+private:
+    QTcpServer m_server;
+    QByteArray m_response;
+    QPointer<QTcpSocket> m_socket;
+    QMap<QTcpSocket*, QByteArray> m_pending;
+    QList<QByteArray> m_requests;
+};
+
+static const QByteArray streamHeader(
+        "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n\r\n");
+
+class EventChannelTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void parse();
+    void reconnect();
+    void idleTimeout();
+    void unsupported_data();
+    void unsupported();
+};
+
+void EventChannelTest::initTestCase()
+{
+    QLoggingCategory::setFilterRules("default.debug=false");
+    QNetworkProxy::setApplicationProxy(QNetworkProxy::NoProxy);
+}
+
+// Events come split between packets, with comments, CRLF line ends and
+// multiline data
+void EventChannelTest::parse()
+{
+    EventServer server(streamHeader);
+    NGEventChannel channel;
+    QSignalSpy connected(&channel, SIGNAL(connected()));
+    QSignalSpy events(&channel, SIGNAL(eventReceived(QString, QByteArray)));
+    channel.open(server.url());
+    QTRY_COMPARE(server.requests().size(), 1);
+
+    // Channel is connected with the first data of event stream
+    server.socket()->write(": heartbeat\n\nevent: license\r\nid: 1\r\ndata: {\"a\":");
+    server.socket()->flush();
+    QTRY_COMPARE(connected.count(), 1);
+    QCOMPARE(events.count(), 0);
+    server.socket()->write("\r\ndata: 1}\r\n\r\ndata: plain\n\ndata\n\n");
+    QTRY_COMPARE(events.count(), 3);
+
+    QCOMPARE(events[0][0].toString(), QString("license"));
+    QCOMPARE(events[0][1].toByteArray(), QByteArray("{\"a\":\n1}"));
+    QCOMPARE(events[1][0].toString(), QString("message"));
+    QCOMPARE(events[1][1].toByteArray(), QByteArray("plain"));
+    QCOMPARE(events[2][1].toByteArray(), QByteArray());
+    QVERIFY(channel.isConnected());
+}
+
+// Closed stream is reopened with id of the last event
+void EventChannelTest::reconnect()
+{
+    EventServer server(streamHeader);
+    NGEventChannel channel;
+    QSignalSpy connected(&channel, SIGNAL(connected()));
+    QSignalSpy disconnected(&channel, SIGNAL(disconnected()));
+    channel.open(server.url());
+    QTRY_COMPARE(server.requests().size(), 1);
+    QVERIFY(!server.requests()[0].contains("Last-Event-ID"));
+
+    server.socket()->write("id: 42\ndata: x\n\n");
+    QTRY_COMPARE(connected.count(), 1);
+    server.socket()->disconnectFromHost();
+    QTRY_COMPARE(disconnected.count(), 1);
+    QTRY_COMPARE_WITH_TIMEOUT(server.requests().size(), 2, 5000);
+    QVERIFY(server.requests()[1].contains("Last-Event-ID: 42\r\n"));
+}
+
+// Silent connection is dropped and opened again
+void EventChannelTest::idleTimeout()
+{
+    EventServer server(streamHeader);
+    NGEventChannel channel;
+    channel.setIdleTimeout(300);
+    QSignalSpy connected(&channel, SIGNAL(connected()));
+    QSignalSpy disconnected(&channel, SIGNAL(disconnected()));
+    channel.open(server.url());
+    QTRY_COMPARE(server.requests().size(), 1);
+
+    // Heartbeats keep connection alive
+    for(int i = 0; i < 4; ++i) {
+        server.socket()->write(":\n\n");
+        QTest::qWait(150);
+    }
+    QCOMPARE(connected.count(), 1);
+    QCOMPARE(disconnected.count(), 0);
+
+    QTRY_COMPARE(disconnected.count(), 1);
+    QTRY_COMPARE_WITH_TIMEOUT(server.requests().size(), 2, 5000);
+}
+
+void EventChannelTest::unsupported_data()
+{
+    QTest::addColumn<QByteArray>("response");
+    QTest::newRow("not found") << QByteArray(
+        "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    QTest::newRow("no content") << QByteArray(
+        "HTTP/1.1 204 No Content\r\nConnection: close\r\n\r\n");
+    QTest::newRow("not a stream") << QByteArray(
+        "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: 6\r\n"
+        "Connection: close\r\n\r\n<html>");
+}
+
+// Server without event stream is not requested again, reconnect would happen
+// after a second
+void EventChannelTest::unsupported()
+{
+    QFETCH(QByteArray, response);
+    EventServer server(response);
+    NGEventChannel channel;
+    QSignalSpy connected(&channel, SIGNAL(connected()));
+    channel.open(server.url());
+    QTRY_COMPARE(server.requests().size(), 1);
+    QTest::qWait(2500);
+    QCOMPARE(server.requests().size(), 1);
+    QCOMPARE(connected.count(), 0);
+    QVERIFY(!channel.isConnected());
+}
+
+QTEST_GUILESS_MAIN(EventChannelTest)
+
+#include "eventchanneltest.moc"
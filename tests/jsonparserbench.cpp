@@ -0,0 +1,203 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library tests
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/jsonparser.h"
+#include "core/util.h"
+
+#include <QtTest>
+
+#include "cpl_json.h"
+
+// NextGIS Web feature listing: attributes, WKT geometry and escaped strings
+static QByteArray features(int count)
+{
+    QByteArray out("{\"type\":\"features\",\"total\":");
+    out.append(QByteArray::number(count));
+    out.append(",\"features\":[");
+    for(int i = 0; i < count; ++i) {
+        if(i > 0) {
+            out.append(',');
+        }
+        out.append(QString(
+            "{\"id\":%1,\"geom\":\"POLYGON((37.61 55.75,37.62 55.75,37.62 55.76,"
+            "37.61 55.76,37.61 55.75))\",\"fields\":{\"name\":\"\\u0423\\u043b\\u0438"
+            "\\u0446\\u0430 %1\",\"area\":%2,\"population\":%3,\"valid\":true,"
+            "\"note\":null,\"tags\":[\"road\",\"city\",\"\\\"quoted\\\"\"]},"
+            "\"extensions\":{\"attachment\":[],\"description\":\"Feature %1 "
+            "with a long description to make strings dominate the document\"}}")
+                   .arg(i).arg(i * 12.5).arg(i * 1000LL).toUtf8());
+    }
+    out.append("]}");
+    return out;
+}
+
+static bool parseNative(const QByteArray &data, QVariantMap &out)
+{
+    JSONParser parser(data.constData(), static_cast<size_t>(data.size()));
+    return parser.parse(out);
+}
+
+static bool parseCPL(const QByteArray &data, QVariantMap &out)
+{
+    CPLJSONDocument doc;
+    if(!doc.LoadMemory(reinterpret_cast<const GByte*>(data.constData()),
+                       data.size())) {
+        return false;
+    }
+    out = toMap(doc.GetRoot());
+    return true;
+}
+
+class JSONParserBench : public QObject
+{
+    Q_OBJECT
+private slots:
+    void sameResult();
+    void invalid_data();
+    void invalid();
+    void paths();
+    void parse_data();
+    void parse();
+    void select_data();
+    void select();
+};
+
+void JSONParserBench::sameResult()
+{
+    QByteArray data = features(3);
+    QVariantMap native, cpl;
+    QVERIFY(parseNative(data, native));
+    QVERIFY(parseCPL(data, cpl));
+    QCOMPARE(native, cpl);
+}
+
+void JSONParserBench::invalid_data()
+{
+    QTest::addColumn<QByteArray>("json");
+    QTest::newRow("trailing garbage") << QByteArray("{\"a\":1} x");
+    QTest::newRow("second root") << QByteArray("{\"a\":1}{}");
+    QTest::newRow("fraction without digits") << QByteArray("{\"a\":1.}");
+    QTest::newRow("exponent without digits") << QByteArray("{\"a\":1e}");
+    QTest::newRow("leading zero") << QByteArray("{\"a\":01}");
+    QTest::newRow("leading plus") << QByteArray("{\"a\":+1}");
+    QTest::newRow("leading dot") << QByteArray("{\"a\":.5}");
+    QTest::newRow("control character") << QByteArray("{\"a\":\"x\ty\"}");
+    QTest::newRow("invalid escape") << QByteArray("{\"a\":\"\\x\"}");
+    QTest::newRow("short unicode escape") << QByteArray("{\"a\":\"\\u12\"}");
+    QTest::newRow("bad literal") << QByteArray("{\"a\":nul}");
+    QTest::newRow("missing colon") << QByteArray("{\"a\" 1}");
+    QTest::newRow("trailing comma") << QByteArray("{\"a\":[1,]}");
+    QTest::newRow("mismatched bracket") << QByteArray("{\"a\":[1}");
+    QTest::newRow("unterminated") << QByteArray("{\"a\":{\"b\":1}");
+}
+
+// Both parse paths reject the same documents. Path selection must not accept
+// garbage in values it skips.
+void JSONParserBench::invalid()
+{
+    QFETCH(QByteArray, json);
+    QVariantMap out;
+    JSONParser full(json.constData(), static_cast<size_t>(json.size()));
+    QVERIFY(!full.parse(out));
+    QVERIFY(!full.errorMessage().isEmpty());
+
+    JSONParser select(json.constData(), static_cast<size_t>(json.size()));
+    QVERIFY(!select.parse(out, QStringList() << "other"));
+}
+
+void JSONParserBench::paths()
+{
+    QByteArray json("\xEF\xBB\xBF{\"user\":{\"name\":\"Ivan\",\"roles\":[\"a\",\"b\"]},"
+                    "\"skip\":{\"x\":[1,2.5e3,-0,{\"y\":\"\\u0041\"}]},\"n\":-12}");
+    QVariantMap out;
+    JSONParser parser(json.constData(), static_cast<size_t>(json.size()));
+    QVERIFY2(parser.parse(out, QStringList() << "user/name" << "/user/roles" << "n"
+                          << "missing/key"), qPrintable(parser.errorMessage()));
+    QCOMPARE(out.size(), 3);
+    QCOMPARE(out["user/name"].toString(), QString("Ivan"));
+    QCOMPARE(out["/user/roles"].toStringList(), QStringList() << "a" << "b");
+    QCOMPARE(out["n"].toInt(), -12);
+}
+
+void JSONParserBench::parse_data()
+{
+    QTest::addColumn<bool>("native");
+    QTest::addColumn<int>("count");
+    for(int count : {100, 20000}) {
+        QTest::newRow(qPrintable(QString("cpl %1").arg(count))) << false << count;
+        QTest::newRow(qPrintable(QString("native %1").arg(count))) << true << count;
+    }
+}
+
+// Whole document to QVariantMap, as jsonToMap/memJsonToMap/getJsonAsMap do
+void JSONParserBench::parse()
+{
+    QFETCH(bool, native);
+    QFETCH(int, count);
+    QByteArray data = features(count);
+    QVariantMap out;
+    bool result = true;
+    if(native) {
+        QBENCHMARK {
+            result &= parseNative(data, out);
+        }
+    }
+    else {
+        QBENCHMARK {
+            result &= parseCPL(data, out);
+        }
+    }
+    QVERIFY(result);
+    QCOMPARE(out["features"].toList().size(), count);
+}
+
+void JSONParserBench::select_data()
+{
+    parse_data();
+}
+
+// Only total count is requested, the rest is validated and skipped
+void JSONParserBench::select()
+{
+    QFETCH(bool, native);
+    QFETCH(int, count);
+    QByteArray data = features(count);
+    QStringList paths = QStringList() << "total";
+    QVariantMap out;
+    if(native) {
+        QBENCHMARK {
+            JSONParser parser(data.constData(), static_cast<size_t>(data.size()));
+            parser.parse(out, paths);
+        }
+    }
+    else {
+        QBENCHMARK {
+            CPLJSONDocument doc;
+            doc.LoadMemory(reinterpret_cast<const GByte*>(data.constData()),
+                           data.size());
+            out = toMap(doc.GetRoot(), paths);
+        }
+    }
+    QCOMPARE(out["total"].toInt(), count);
+}
+
+QTEST_APPLESS_MAIN(JSONParserBench)
+
+#include "jsonparserbench.moc"
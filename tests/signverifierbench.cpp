@@ -0,0 +1,203 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Framework Library tests
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "access/signverifier.h"
+
+#include <QLoggingCategory>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+
+#include <cstdio>
+
+constexpr int messageCount = 512;
+
+// NGAccess::verifyRSASignature as it was before NGSignVerifier: key file is
+// parsed and digest context is created on every call
+static bool verifyUncached(const QString &keyPath, const QByteArray &message,
+                           const QByteArray &signature)
+{
+    FILE *file = fopen(keyPath.toLocal8Bit().constData(), "r");
+    if(!file) {
+        return false;
+    }
+    EVP_PKEY *pubkey = PEM_read_PUBKEY(file, nullptr, nullptr, nullptr);
+    fclose(file);
+    if(!pubkey) {
+        return false;
+    }
+    EVP_MD_CTX *ctx = EVP_MD_CTX_create();
+    EVP_VerifyInit(ctx, EVP_sha256());
+    EVP_VerifyUpdate(ctx, message.constData(), static_cast<size_t>(message.size()));
+    int result = EVP_VerifyFinal(ctx,
+        reinterpret_cast<const unsigned char*>(signature.constData()),
+        static_cast<unsigned int>(signature.size()), pubkey);
+    EVP_MD_CTX_destroy(ctx);
+    EVP_PKEY_free(pubkey);
+    return result == 1;
+}
+
+class SignVerifierBench : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void keyChange();
+    void shiftedSignature();
+    void verify_data();
+    void verify();
+
+private:
+    QByteArray sign(const QByteArray &message) const;
+
+private:
+    QTemporaryDir m_dir;
+    QString m_keyPath;
+    EVP_PKEY *m_key = nullptr;
+    QVector<QByteArray> m_messages;
+    QVector<QByteArray> m_signs;
+};
+
+void SignVerifierBench::initTestCase()
+{
+    // Verifier reports every check at debug level
+    QLoggingCategory::setFilterRules("default.debug=false");
+    QVERIFY(m_dir.isValid());
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
+    QVERIFY(ctx);
+    QVERIFY(EVP_PKEY_keygen_init(ctx) > 0);
+    QVERIFY(EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) > 0);
+    QVERIFY(EVP_PKEY_keygen(ctx, &m_key) > 0);
+    EVP_PKEY_CTX_free(ctx);
+
+    m_keyPath = m_dir.filePath("public.key");
+    FILE *file = fopen(m_keyPath.toLocal8Bit().constData(), "w");
+    QVERIFY(file);
+    PEM_write_PUBKEY(file, m_key);
+    fclose(file);
+
+    // Same layout as support info message: user id, dates and account type
+    for(int i = 0; i < messageCount; ++i) {
+        QByteArray message = "user" + QByteArray::number(i) +
+                "2024-01-012025-01-01true";
+        m_messages.append(message);
+        m_signs.append(sign(message));
+    }
+}
+
+void SignVerifierBench::cleanupTestCase()
+{
+    EVP_PKEY_free(m_key);
+}
+
+QByteArray SignVerifierBench::sign(const QByteArray &message) const
+{
+    QByteArray out(EVP_PKEY_size(m_key), Qt::Uninitialized);
+    unsigned int size = 0;
+    EVP_MD_CTX *ctx = EVP_MD_CTX_create();
+    EVP_SignInit(ctx, EVP_sha256());
+    EVP_SignUpdate(ctx, message.constData(), static_cast<size_t>(message.size()));
+    EVP_SignFinal(ctx, reinterpret_cast<unsigned char*>(out.data()), &size, m_key);
+    EVP_MD_CTX_destroy(ctx);
+    out.resize(static_cast<int>(size));
+    return out;
+}
+
+// Key from other path is loaded, removed key file fails instead of using
+// cached key or remembered results
+void SignVerifierBench::keyChange()
+{
+    NGSignVerifier verifier;
+    QString errorMsg;
+    QVERIFY(verifier.verify(m_keyPath, m_messages[0], m_signs[0], errorMsg));
+    QVERIFY(!verifier.verify(m_keyPath, m_messages[1], m_signs[0], errorMsg));
+
+    QString otherPath = m_dir.filePath("other.key");
+    QVERIFY(QFile::copy(m_keyPath, otherPath));
+    QVERIFY(verifier.verify(otherPath, m_messages[0], m_signs[0], errorMsg));
+
+    QFile::remove(otherPath);
+    QVERIFY(!verifier.verify(otherPath, m_messages[0], m_signs[0], errorMsg));
+    QVERIFY(!errorMsg.isEmpty());
+}
+
+// Bytes moved from message end to signature start must not hit remembered
+// result of the valid pair
+void SignVerifierBench::shiftedSignature()
+{
+    NGSignVerifier verifier;
+    QString errorMsg;
+    const QByteArray &message = m_messages[0];
+    const QByteArray &signature = m_signs[0];
+    QVERIFY(verifier.verify(m_keyPath, message, signature, errorMsg));
+    QVERIFY(verifier.verify(m_keyPath, message, signature, errorMsg));
+
+    // Old key was SHA256(message + signature + size): for 29 bytes message the
+    // pair of 9 bytes message and the rest + signature + "2" gave the same key
+    QByteArray size = QByteArray::number(message.size());
+    int shortSize = size.right(1).toInt();
+    QVERIFY(shortSize > 0);
+    QByteArray shiftedSignature = message.mid(shortSize) + signature +
+            size.left(size.size() - 1);
+    QVERIFY(!verifier.verify(m_keyPath, message.left(shortSize), shiftedSignature,
+                             errorMsg));
+    QVERIFY(!verifier.verify(m_keyPath, message.left(message.size() - 1),
+                             message.right(1) + signature, errorMsg));
+}
+
+// uncached - every call parses key file, cached - parsed key and context are
+// reused but messages do not repeat within result cache size, memoized - the
+// same few messages are checked again and again as plugin signs are
+void SignVerifierBench::verify_data()
+{
+    QTest::addColumn<int>("mode");
+    QTest::newRow("uncached") << 0;
+    QTest::newRow("cached") << 1;
+    QTest::newRow("memoized") << 2;
+}
+
+void SignVerifierBench::verify()
+{
+    QFETCH(int, mode);
+    NGSignVerifier verifier;
+    QString errorMsg;
+    int index = 0;
+    bool valid = true;
+    int count = mode == 2 ? 16 : messageCount;
+    QBENCHMARK {
+        int i = index++ % count;
+        if(mode == 0) {
+            valid &= verifyUncached(m_keyPath, m_messages[i], m_signs[i]);
+        }
+        else {
+            valid &= verifier.verify(m_keyPath, m_messages[i], m_signs[i],
+                                     errorMsg);
+        }
+    }
+    QVERIFY(valid);
+}
+
+QTEST_GUILESS_MAIN(SignVerifierBench)
+
+#include "signverifierbench.moc"
@@ -0,0 +1,231 @@
+/******************************************************************************
+*  Project: NextGIS GIS libraries
+*  Purpose: Core Library tests
+*  Author:  Dmitry Baryshnikov, bishop.dev@gmail.com
+*******************************************************************************
+*  Copyright (C) 2012-2020 NextGIS, info@nextgis.ru
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 2 of the License, or
+*   (at your option) any later version.
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "core/core.h"
+#include "core/util.h"
+
+#include <QtTest>
+
+#include "cpl_json.h"
+#include "cpl_vsi.h"
+
+// toMap as it was before nested values support: objects and arrays are
+// serialized back to strings
+static QVariant toVariantFlat(const CPLJSONObject &value)
+{
+    switch(value.GetType()) {
+    case CPLJSONObject::Type::Boolean:
+        return value.ToBool();
+    case CPLJSONObject::Type::String:
+        return QString::fromUtf8(value.ToString().c_str());
+    case CPLJSONObject::Type::Integer:
+        return value.ToInteger();
+    case CPLJSONObject::Type::Long:
+        return static_cast<qlonglong>(value.ToLong());
+    case CPLJSONObject::Type::Double:
+        return value.ToDouble();
+    default:
+        return QString::fromUtf8(value.ToString().c_str());
+    }
+}
+
+static QMap<QString, QVariant> toMapFlat(const CPLJSONObject &root)
+{
+    QMap<QString, QVariant> out;
+    for(const CPLJSONObject &child : root.GetChildren()) {
+        out[QString::fromStdString(child.GetName())] = toVariantFlat(child);
+    }
+    return out;
+}
+
+// Keycloak user info with client roles
+static QByteArray userInfo()
+{
+    return QByteArray(
+        "{\"sub\":\"6f0e2a4c-8d1b-4e55-9a53-0c1d2e3f4a5b\","
+        "\"email_verified\":true,\"name\":\"Ivan Ivanov\","
+        "\"preferred_username\":\"ivanov\",\"given_name\":\"Ivan\","
+        "\"family_name\":\"Ivanov\",\"email\":\"ivanov@example.com\","
+        "\"realm_access\":{\"roles\":[\"offline_access\",\"uma_authorization\"]},"
+        "\"resource_access\":{\"ngstd\":{\"roles\":[\"user\",\"editor\",\"manager\"]},"
+        "\"account\":{\"roles\":[\"manage-account\",\"view-profile\"]}}}");
+}
+
+// NextGIS Web resource children listing
+static QByteArray resources(int count)
+{
+    QByteArray out("{\"resources\":[");
+    for(int i = 0; i < count; ++i) {
+        if(i > 0) {
+            out.append(',');
+        }
+        out.append(QString(
+            "{\"resource\":{\"id\":%1,\"cls\":\"vector_layer\",\"parent\":{\"id\":0},"
+            "\"owner_user\":{\"id\":4},\"permissions\":[],\"keyname\":null,"
+            "\"display_name\":\"Layer %1\",\"description\":null,\"children\":false,"
+            "\"interfaces\":[\"IFeatureLayer\",\"IWritableFeatureLayer\"],"
+            "\"scopes\":[\"resource\",\"datastruct\",\"data\"]},"
+            "\"resmeta\":{\"items\":{\"source\":\"import\",\"scale\":25000.5}},"
+            "\"vector_layer\":{\"srs\":{\"id\":3857},\"geometry_type\":\"POINT\"}}")
+                   .arg(i).toUtf8());
+    }
+    out.append("]}");
+    return out;
+}
+
+class ToMapBench : public QObject
+{
+    Q_OBJECT
+private slots:
+    void nested();
+    void vsiFile();
+    void roles_data();
+    void roles();
+    void listing_data();
+    void listing();
+};
+
+void ToMapBench::nested()
+{
+    CPLJSONDocument doc;
+    QByteArray data = resources(2);
+    QVERIFY(doc.LoadMemory(reinterpret_cast<const GByte*>(data.constData()),
+                           data.size()));
+    QVariantList list = toMap(doc.GetRoot())["resources"].toList();
+    QCOMPARE(list.size(), 2);
+    QVariantMap resource = list[1].toMap()["resource"].toMap();
+    QCOMPARE(resource["id"].toInt(), 1);
+    QCOMPARE(resource["parent"].toMap()["id"].toInt(), 0);
+    QVERIFY(resource["permissions"].toList().isEmpty());
+    QVERIFY(!resource["keyname"].isValid());
+    QCOMPARE(resource["scopes"].toStringList().size(), 3);
+}
+
+// GDAL virtual files are read with VSI API, QFile does not see them
+void ToMapBench::vsiFile()
+{
+    QByteArray data = userInfo();
+    const char *path = "/vsimem/tomapbench/userinfo.json";
+    VSIFCloseL(VSIFileFromMemBuffer(path,
+        reinterpret_cast<GByte*>(data.data()), data.size(), FALSE));
+    QVariantMap map = jsonToMap(path);
+    QCOMPARE(map["preferred_username"].toString(), QString("ivanov"));
+    map = jsonToMap(path, QStringList() << "email");
+    QCOMPARE(map.size(), 1);
+    QCOMPARE(map["email"].toString(), QString("ivanov@example.com"));
+    VSIUnlink(path);
+    QVERIFY(jsonToMap(path).isEmpty());
+}
+
+void ToMapBench::roles_data()
+{
+    QTest::addColumn<bool>("nested");
+    QTest::newRow("reparse") << false;
+    QTest::newRow("nested") << true;
+}
+
+// Roles as updateUserInfoFunction reads them: before the change
+// resource_access came as a string and was parsed once more
+void ToMapBench::roles()
+{
+    QFETCH(bool, nested);
+    QByteArray data = userInfo();
+    CPLJSONDocument doc;
+    QVERIFY(doc.LoadMemory(reinterpret_cast<const GByte*>(data.constData()),
+                           data.size()));
+    CPLJSONObject root = doc.GetRoot();
+
+    QStringList roles;
+    if(nested) {
+        QBENCHMARK {
+            QVariantMap map = toMap(root);
+            roles = map["resource_access"].toMap()["ngstd"].toMap()["roles"].toStringList();
+        }
+    }
+    else {
+        QBENCHMARK {
+            QVariantMap map = toMapFlat(root);
+            roles.clear();
+            std::string ra = map["resource_access"].toString().toStdString();
+            CPLJSONDocument raDoc;
+            if(raDoc.LoadMemory(ra)) {
+                CPLJSONArray array = raDoc.GetRoot().GetArray("ngstd/roles");
+                for(int i = 0; i < array.Size(); ++i) {
+                    roles.append(array[i].ToString().c_str());
+                }
+            }
+        }
+    }
+    QCOMPARE(roles, QStringList() << "user" << "editor" << "manager");
+}
+
+void ToMapBench::listing_data()
+{
+    QTest::addColumn<bool>("nested");
+    QTest::addColumn<int>("count");
+    for(int count : {10, 1000}) {
+        QTest::newRow(qPrintable(QString("reparse %1").arg(count))) << false << count;
+        QTest::newRow(qPrintable(QString("nested %1").arg(count))) << true << count;
+    }
+}
+
+// Display names of listed resources
+void ToMapBench::listing()
+{
+    QFETCH(bool, nested);
+    QFETCH(int, count);
+    QByteArray data = resources(count);
+    CPLJSONDocument doc;
+    QVERIFY(doc.LoadMemory(reinterpret_cast<const GByte*>(data.constData()),
+                           data.size()));
+    CPLJSONObject root = doc.GetRoot();
+
+    QStringList names;
+    if(nested) {
+        QBENCHMARK {
+            names.clear();
+            QVariantMap map = toMap(root);
+            for(const QVariant &item : map["resources"].toList()) {
+                names.append(item.toMap()["resource"].toMap()["display_name"].toString());
+            }
+        }
+    }
+    else {
+        QBENCHMARK {
+            names.clear();
+            QVariantMap map = toMapFlat(root);
+            std::string list = map["resources"].toString().toStdString();
+            CPLJSONDocument listDoc;
+            if(listDoc.LoadMemory(list)) {
+                CPLJSONArray array = listDoc.GetRoot().ToArray();
+                for(int i = 0; i < array.Size(); ++i) {
+                    names.append(QString::fromUtf8(
+                        array[i].GetString("resource/display_name").c_str()));
+                }
+            }
+        }
+    }
+    QCOMPARE(names.size(), count);
+    QCOMPARE(names.last(), QString("Layer %1").arg(count - 1));
+}
+
+QTEST_APPLESS_MAIN(ToMapBench)
+
+#include "tomapbench.moc"